@@ -49,6 +49,11 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 
+#ifdef HAVE_LINUX_OPENAT2_H
+#include <linux/openat2.h>
+#include <sys/syscall.h>
+#endif /* HAVE_LINUX_OPENAT2_H */
+
 #include "file.h"
 
 #define NEWLINE "\n\r"
@@ -140,27 +145,83 @@ path_make_absolute(const char *p, const char *prefix)
 	return r;
 }
 
+/* Like path_make_absolute() but joins the path with the prefix into the
+ * given buffer.  Returns P itself if it's absolute, NULL and sets errno to
+ * ENAMETOOLONG if the result doesn't fit.  */
+const char *
+path_join(const char *p, const char *prefix, char *buf, size_t size)
+{
+	size_t plen, len;
+
+	if (path_is_absolute(p) || !prefix)
+		return p;
+
+	plen = strlen(prefix);
+	len = strlen(p);
+	if (plen + len + 2 > size) {
+		errno = ENAMETOOLONG;
+		return NULL;
+	}
+
+	memcpy(buf, prefix, plen);
+	buf[plen] = '/';
+	memcpy(buf + plen + 1, p, len + 1);
+	return buf;
+}
+
+static const can_ops_t can_ops_default = {
+	.lstat = lstat,
+	.readlink = readlink,
+};
+
 /* Return the canonical absolute name of file NAME.  A canonical name
    does not contain any `.', `..' components nor any repeated file name
    separators ('/') or symlinks.  Whether components must exist
-   or not depends on canonicalize mode.  The result is malloc'd.  */
+   or not depends on canonicalize mode.  The file system is looked up
+   using OPS, or lstat() and readlink() if OPS is NULL.  The result is
+   malloc'd.  */
+int
+canonicalize_filename_mode(const char *name, can_mode_t mode, int resolve,
+		const can_ops_t *ops, char **path)
+{
+	return canonicalize_filename_mode_r(name, mode, resolve, ops, NULL, 0, path, NULL);
+}
+
+/* Like canonicalize_filename_mode() but the result is written into BUF of
+   SIZE bytes, if BUF isn't NULL.  Only names which don't fit into BUF or
+   PATH_MAX bytes touch the heap, the result is malloc'd then.  Callers must
+   free the result unless it's BUF.  The type of the file the result names,
+   i.e. the S_IFMT bits of its mode as found by looking it up, is stored in
+   FTYPE unless it's NULL, zero if it doesn't exist.  */
 int
-canonicalize_filename_mode(const char *name, can_mode_t mode, int resolve, char **path)
+canonicalize_filename_mode_r(const char *name, can_mode_t mode, int resolve,
+		const can_ops_t *ops, char *buf, size_t size, char **path, mode_t *ftype)
 {
 	int linkcount = 0, ret = 0;
+	mode_t last = S_IFDIR;
 	char *rname, *dest, *extra_buf = NULL;
 	const char *start;
 	const char *end;
 	const char *rname_limit;
 	size_t extra_len = 0;
+	char extra_stack[PATH_MAX];
+	char link[PATH_MAX];
 
 	if (!name || name[0] == '\0' || name[0] != '/')
 		return -EINVAL;
+	if (!ops)
+		ops = &can_ops_default;
 
-	rname = malloc(PATH_MAX * sizeof(char));
-	if (!rname)
-		return -ENOMEM;
-	rname_limit = rname + PATH_MAX;
+	if (buf && size > 1) {
+		rname = buf;
+		rname_limit = rname + size;
+	}
+	else {
+		rname = malloc(PATH_MAX * sizeof(char));
+		if (!rname)
+			return -ENOMEM;
+		rname_limit = rname + PATH_MAX;
+	}
 	rname[0] = '/';
 	dest = rname + 1;
 
@@ -175,8 +236,10 @@ canonicalize_filename_mode(const char *name, can_mode_t mode, int resolve, char
 
 		if (end - start == 0)
 			break;
-		else if (end - start == 1 && start[0] == '.')
-			/* void */;
+		else if (end - start == 1 && start[0] == '.') {
+			/* Every component but the last one is a directory */
+			last = S_IFDIR;
+		}
 		else if (end - start == 2 && start[0] == '.' && start[1] == '.') {
 			/* Back up previous component, ignore if at root
 			 * already. */
@@ -184,6 +247,7 @@ canonicalize_filename_mode(const char *name, can_mode_t mode, int resolve, char
 				while ((--dest)[-1] != '/')
 					/* void */;
 			}
+			last = S_IFDIR;
 		}
 		else {
 			struct stat st;
@@ -200,9 +264,19 @@ canonicalize_filename_mode(const char *name, can_mode_t mode, int resolve, char
 				else
 					new_size += PATH_MAX;
 
-				rname = realloc(rname, new_size);
-				if (!rname)
+				if (rname == buf) {
+					char *heap = malloc(new_size);
+					if (heap)
+						memcpy(heap, buf, dest_offset);
+					rname = heap;
+				}
+				else
+					rname = realloc(rname, new_size);
+				if (!rname) {
+					if (extra_buf && extra_buf != extra_stack)
+						free(extra_buf);
 					return -ENOMEM;
+				}
 				rname_limit = rname + new_size;
 
 				dest = rname + dest_offset;
@@ -212,16 +286,17 @@ canonicalize_filename_mode(const char *name, can_mode_t mode, int resolve, char
 			dest += end - start;
 			*dest = '\0';
 
-			if (lstat(rname, &st) != 0) {
+			if (ops->lstat(rname, &st) != 0) {
 				if (mode == CAN_EXISTING)
 					goto error;
 				if (mode == CAN_ALL_BUT_LAST && *end)
 					goto error;
 				st.st_mode = 0;
 			}
+			last = st.st_mode & S_IFMT;
 
 			if (S_ISLNK(st.st_mode)) {
-				char *buf;
+				ssize_t r;
 				size_t n, len;
 
 				if (!resolve)
@@ -240,34 +315,54 @@ canonicalize_filename_mode(const char *name, can_mode_t mode, int resolve, char
 					goto error;
 				}
 
-				if (readlink_alloc(rname, &buf) < 0)
+				if ((r = ops->readlink(rname, link, sizeof(link))) < 0)
+					goto error;
+				if ((size_t)r >= sizeof(link)) {
+					errno = ENAMETOOLONG;
 					goto error;
+				}
 
-				n = strlen(buf);
+				n = r;
 				len = strlen(end);
 
 				if (!extra_len) {
-					extra_len = (n + len + 1) > PATH_MAX
-						? (n + len + 1)
-						: PATH_MAX;
-					extra_buf = malloc(extra_len * sizeof(char));
+					if (n + len + 1 > PATH_MAX) {
+						extra_len = n + len + 1;
+						extra_buf = malloc(extra_len * sizeof(char));
+					}
+					else {
+						extra_len = PATH_MAX;
+						extra_buf = extra_stack;
+					}
 				}
 				else if (n + len + 1 > extra_len) {
+					char *old = extra_buf;
+					size_t old_len = extra_len;
+
 					extra_len = n + len + 1;
-					extra_buf = realloc(extra_buf, extra_len * sizeof(char));
+					if (extra_buf == extra_stack) {
+						if ((extra_buf = malloc(extra_len * sizeof(char))))
+							memcpy(extra_buf, old, old_len);
+					}
+					else
+						extra_buf = realloc(extra_buf, extra_len * sizeof(char));
+					/* end may point into the old buffer */
+					if (extra_buf && end >= old && end < old + old_len)
+						end = extra_buf + (end - old);
 				}
 
 				if (!extra_buf) {
-					free(rname);
+					if (rname != buf)
+						free(rname);
 					return -ENOMEM;
 				}
 
 				/* Careful here, end may be a pointer into
 				 * extra_buf... */
 				memmove(&extra_buf[n], end, len + 1);
-				name = end = memcpy(extra_buf, buf, n);
+				name = end = memcpy(extra_buf, link, n);
 
-				if (buf[0] == '/')
+				if (link[0] == '/')
 					dest = rname + 1; /* Absolute symlink */
 				else {
 					/* Back up to previous component,
@@ -277,8 +372,6 @@ canonicalize_filename_mode(const char *name, can_mode_t mode, int resolve, char
 							/* void */;
 					}
 				}
-
-				free(buf);
 			}
 			else {
 				if (!S_ISDIR(st.st_mode) && *end) {
@@ -292,27 +385,151 @@ canonicalize_filename_mode(const char *name, can_mode_t mode, int resolve, char
 	if (dest > rname + 1 && dest[-1] == '/')
 		--dest;
 	*dest = '\0';
+	if (dest == rname + 1)
+		last = S_IFDIR;
 
-	if (rname_limit != dest + 1) {
+	if (rname != buf && rname_limit != dest + 1) {
 		rname = realloc(rname, dest - rname + 1);
 		if (!rname)
 			goto error;
 	}
 
-	if (extra_buf)
+	if (extra_buf && extra_buf != extra_stack)
 		free(extra_buf);
 	*path = rname;
+	if (ftype)
+		*ftype = last;
 	return 0;
 
 error:
 	ret = -errno;
-	if (extra_buf)
+	if (extra_buf && extra_buf != extra_stack)
 		free(extra_buf);
-	if (rname)
+	if (rname && rname != buf)
 		free(rname);
 	return ret;
 }
 
+#if defined(HAVE_LINUX_OPENAT2_H) && defined(SYS_openat2)
+static int openat2_broken;
+
+/* Open NAME with O_PATH and read the canonical name of the file back from
+ * /proc/self/fd.  Returns the file descriptor or -errno. */
+static int
+openat2_path(int dirfd, const char *name, int flags, char **path)
+{
+	int fd, ret;
+	char proc[sizeof("/proc/self/fd/") + sizeof(int) * 3];
+	struct open_how how;
+
+	memset(&how, 0, sizeof(struct open_how));
+	how.flags = O_PATH | O_CLOEXEC | flags;
+	/* Magic links of /proc don't have a canonical name */
+	how.resolve = RESOLVE_NO_MAGICLINKS;
+
+	fd = syscall(SYS_openat2, dirfd, name, &how, sizeof(struct open_how));
+	if (fd < 0) {
+		if (errno == ENOSYS)
+			openat2_broken = 1;
+		return -errno;
+	}
+
+	if (!path)
+		return fd;
+
+	snprintf(proc, sizeof(proc), "/proc/self/fd/%d", fd);
+	if ((ret = readlink_alloc(proc, path)) < 0) {
+		close(fd);
+		return ret;
+	}
+
+	/* The file was removed in the meantime */
+	if ((*path)[0] != '/' || strstr(*path, " (deleted)")) {
+		free(*path);
+		close(fd);
+		return -EOPNOTSUPP;
+	}
+
+	return fd;
+}
+#endif
+
+/* Return the canonical absolute name of file NAME like
+   canonicalize_filename_mode() with RESOLVE set, using openat2() to walk
+   the path in the kernel with a single system call.  Returns -EOPNOTSUPP
+   if the kernel doesn't support openat2() or the result may differ from
+   the one of canonicalize_filename_mode(), e.g. for dangling symbolic links
+   or paths under /proc.  The result is malloc'd, the type of the file is
+   stored in FTYPE like canonicalize_filename_mode_r() does.  */
+int
+canonicalize_filename_openat2(const char *name, can_mode_t mode, char **path, mode_t *ftype)
+{
+#if defined(HAVE_LINUX_OPENAT2_H) && defined(SYS_openat2)
+	int fd, ret;
+	size_t len;
+	char *dname, *base, *rname;
+	struct stat st;
+
+	if (!name || name[0] == '\0' || name[0] != '/')
+		return -EINVAL;
+	if (openat2_broken)
+		return -EOPNOTSUPP;
+	if (!strncmp(name, "/proc", 5) && (name[5] == '/' || name[5] == '\0'))
+		return -EOPNOTSUPP;
+	if ((len = strlen(name)) >= PATH_MAX)
+		return -EOPNOTSUPP;
+
+	if ((fd = openat2_path(AT_FDCWD, name, 0, path)) >= 0) {
+		/* The file was found already, this doesn't walk the path again */
+		if (ftype)
+			*ftype = fstat(fd, &st) < 0 ? 0 : st.st_mode & S_IFMT;
+		close(fd);
+		return 0;
+	}
+	ret = fd;
+
+	/* The kernel gives up on symbolic link loops earlier,
+	 * and refuses to cross magic links and racing renames. */
+	if (ret == -ENOSYS || ret == -ELOOP || ret == -EXDEV || ret == -EAGAIN)
+		return -EOPNOTSUPP;
+	if (ret != -ENOENT || mode != CAN_ALL_BUT_LAST)
+		return ret;
+
+	/* The last component may not exist, look up its parent */
+	if (name[len - 1] == '/')
+		return -EOPNOTSUPP;
+	base = strrchr(name, '/') + 1;
+	if (!strcmp(base, ".") || !strcmp(base, ".."))
+		return -EOPNOTSUPP;
+
+	if (!(dname = strndup(name, base - name)))
+		return -ENOMEM;
+	fd = openat2_path(AT_FDCWD, dname, O_DIRECTORY, &rname);
+	free(dname);
+	if (fd < 0)
+		return (fd == -ENOSYS || fd == -ELOOP || fd == -EXDEV || fd == -EAGAIN)
+			? -EOPNOTSUPP : fd;
+
+	/* A dangling symbolic link is resolved by canonicalize_filename_mode() */
+	if (fstatat(fd, base, &st, AT_SYMLINK_NOFOLLOW) == 0 || errno != ENOENT) {
+		close(fd);
+		free(rname);
+		return -EOPNOTSUPP;
+	}
+	close(fd);
+
+	ret = asprintf(path, "%s%s%s", rname, rname[1] ? "/" : "", base);
+	free(rname);
+	if (ret < 0)
+		return -ENOMEM;
+	if (ftype)
+		*ftype = 0;
+	return 0;
+#else
+	return -EOPNOTSUPP;
+#endif
+}
+
 int
 read_one_line_file(const char *fn, char **line)
 {
@@ -21,12 +21,21 @@
 #define FILE_H 1
 
 #include <stddef.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 
 typedef enum {
 	CAN_EXISTING = 0,
 	CAN_ALL_BUT_LAST,
 } can_mode_t;
 
+/* File system lookups of canonicalize_filename_mode(), the lstat function must
+ * fill in st_mode at least and both behave like the system calls */
+typedef struct {
+	int (*lstat) (const char *path, struct stat *buf);
+	ssize_t (*readlink) (const char *path, char *buf, size_t size);
+} can_ops_t;
+
 char *truncate_nl(char *s);
 
 int basename_alloc(const char *path, char **buf);
@@ -34,7 +43,12 @@ int readlink_alloc(const char *path, char **buf);
 
 int path_is_absolute(const char *p);
 char *path_make_absolute(const char *p, const char *prefix);
-int canonicalize_filename_mode(const char *name, can_mode_t mode, int resolve, char **path);
+const char *path_join(const char *p, const char *prefix, char *buf, size_t size);
+int canonicalize_filename_mode(const char *name, can_mode_t mode, int resolve,
+		const can_ops_t *ops, char **path);
+int canonicalize_filename_mode_r(const char *name, can_mode_t mode, int resolve,
+		const can_ops_t *ops, char *buf, size_t size, char **path, mode_t *ftype);
+int canonicalize_filename_openat2(const char *name, can_mode_t mode, char **path, mode_t *ftype);
 
 int read_one_line_file(const char *fn, char **line);
 
@@ -166,3 +166,49 @@ hashtable_find(hashtable_t *tbl, int64 key, int allocate_if_missing)
 	tbl->entries++;
 	return node;
 }
+
+int64
+hash_str(const char *str)
+{
+	uint64_t h = HASH_STR_SEED;
+
+	for (; *str; str++)
+		h = HASH_STR_STEP(h, *str);
+	return h ? (int64)h : 1;
+}
+
+int64
+hash_strn(const char *str, size_t len)
+{
+	uint64_t h = HASH_STR_SEED;
+
+	for (size_t i = 0; i < len; i++)
+		h = HASH_STR_STEP(h, str[i]);
+	return h ? (int64)h : 1;
+}
+
+/* Make sure the cache exists, dropping it first if it grew too large.
+ * Returns 0 on success, negated errno on failure. */
+int
+hashtable_cache_prepare(hashtable_t **tbl, int size, int max, void (*free_data)(void *))
+{
+	if (*tbl && (*tbl)->entries <= max)
+		return 0;
+	hashtable_cache_free(tbl, free_data);
+	return hashtable_create(size, 1, tbl);
+}
+
+void
+hashtable_cache_free(hashtable_t **tbl, void (*free_data)(void *))
+{
+	if (!*tbl)
+		return;
+
+	for (int i = 0; i < (*tbl)->size; i++) {
+		ht_int64_node_t *node = HT_NODE(*tbl, (*tbl)->nodes, i);
+		if (node->data)
+			free_data(node->data);
+	}
+	hashtable_destroy(*tbl);
+	*tbl = NULL;
+}
@@ -144,4 +144,15 @@ int hashtable_create(int size, int key64, hashtable_t **tbl);
 void hashtable_destroy(hashtable_t *tbl);
 void *hashtable_find(hashtable_t *tbl, int64 key, int allocate_if_missing);
 
+/* FNV-1a hash of strings to key the tables with, zero is never returned */
+#define HASH_STR_SEED		14695981039346656037ULL
+#define HASH_STR_STEP(h, c)	(((h) ^ (unsigned char)(c)) * 1099511628211ULL)
+int64 hash_str(const char *str);
+int64 hash_strn(const char *str, size_t len);
+
+/* Caches keyed by a 64 bit hash: entries with colliding keys replace each
+ * other, and the table is dropped when it holds more than max entries. */
+int hashtable_cache_prepare(hashtable_t **tbl, int size, int max, void (*free_data)(void *));
+void hashtable_cache_free(hashtable_t **tbl, void (*free_data)(void *));
+
 #endif /* !HASHTABLE_H */
@@ -122,13 +122,34 @@ box_report_violation_sock(pink_easy_process_t *current, const sys_info_t *info,
 	}
 }
 
+/* Look up path components in the cache shared by all processes */
+static const can_ops_t box_can_ops = {
+	.lstat = dcache_lstat,
+	.readlink = dcache_readlink,
+};
+
+/*
+ * Scratch buffers of path resolution: the absolute path is joined into the
+ * first one and resolved into the second one. A tracer handles one system
+ * call at a time, so they are shared by all processes and the heap is only
+ * touched for paths longer than PATH_MAX. The resolved path of the last call
+ * is kept in box_reslong if it didn't fit.
+ */
+static char box_pathbuf[PATH_MAX];
+static char box_resbuf[PATH_MAX];
+static char *box_reslong;
+
 static int
-box_resolve_path_helper(const char *abspath, pid_t pid, int maycreat, int resolve, char **res)
+box_resolve_path_helper(const char *abspath, pid_t pid, int maycreat, int resolve, char **res, mode_t *ftype)
 {
 	int r;
-	char *p;
+	const char *path;
+	can_mode_t mode;
+#ifdef HAVE_PROC_SELF
+	char self[PATH_MAX];
+#endif /* HAVE_PROC_SELF */
 
-	p = NULL;
+	path = abspath;
 #ifdef HAVE_PROC_SELF
 	/* Special case for /proc/self.
 	 * This symbolic link resolves to /proc/$pid, if we let
@@ -137,54 +158,165 @@ box_resolve_path_helper(const char *abspath, pid_t pid, int maycreat, int resolv
 	if (startswith(abspath, "/proc/self")) {
 		const char *tail = abspath + STRLEN_LITERAL("/proc/self");
 		if (!*tail || *tail == '/') {
-			if (asprintf(&p, "/proc/%lu%s", (unsigned long)pid, tail) < 0)
-				return -errno;
+			if ((size_t)snprintf(self, sizeof(self), "/proc/%lu%s", (unsigned long)pid, tail) >= sizeof(self))
+				return -ENAMETOOLONG;
+			path = self;
 		}
 	}
 #endif /* HAVE_PROC_SELF */
 
-	r = canonicalize_filename_mode(p ? p : abspath, maycreat ? CAN_ALL_BUT_LAST : CAN_EXISTING, resolve, res);
-	if (p)
-		free(p);
+	mode = maycreat ? CAN_ALL_BUT_LAST : CAN_EXISTING;
+
+	/* Walk the path in the kernel if possible, fall back otherwise */
+	r = -EOPNOTSUPP;
+	if (pandora->config.use_openat2 && resolve) {
+		r = canonicalize_filename_openat2(path, mode, res, ftype);
+		if (r != -EOPNOTSUPP)
+			++pandora->stats.resolve_openat2;
+	}
+	if (r == -EOPNOTSUPP)
+		r = canonicalize_filename_mode_r(path, mode, resolve, &box_can_ops,
+				box_resbuf, sizeof(box_resbuf), res, ftype);
 	return r;
 }
 
+/*
+ * Resolve the path, relative to prefix unless it's absolute.
+ * Returns 0 and stores the resolved path, which is valid until the next call,
+ * and the type of the file found while resolving it in res on success,
+ * negated errno on failure. Callers can tell whether the file exists from the
+ * type without looking it up again.
+ */
 int
-box_resolve_path(const char *path, const char *prefix, pid_t pid, int maycreat, int resolve, char **res)
+box_resolve_path(const char *path, const char *prefix, pid_t pid, proc_data_t *data, int maycreat, int resolve, resolve_result_t *res)
 {
 	int r;
-	char *abspath;
+	mode_t ftype;
+	unsigned long long start;
+	const char *abspath;
+	char *heap, *resolved;
+
+	if (box_reslong) {
+		free(box_reslong);
+		box_reslong = NULL;
+	}
 
-	abspath = path_make_absolute(path, prefix);
-	if (!abspath)
-		return -errno;
+	heap = NULL;
+	if (!(abspath = path_join(path, prefix, box_pathbuf, sizeof(box_pathbuf)))) {
+		if (!(abspath = heap = path_make_absolute(path, prefix)))
+			return -errno;
+	}
 
-	r = box_resolve_path_helper(abspath, pid, maycreat, resolve, res);
-	free(abspath);
+	start = stats_now();
+	if (!heap && prefix_resolve(abspath, maycreat, resolve, &r, &ftype)) {
+		/* The path is canonical already */
+		if (!r) {
+			res->path = abspath;
+			res->type = ftype;
+		}
+	}
+	else if (!resolve_cache_lookup(data, abspath, maycreat, resolve, &r, res)) {
+		r = box_resolve_path_helper(abspath, pid, maycreat, resolve, &resolved, &ftype);
+		if (!r) {
+			res->path = resolved;
+			res->type = ftype;
+		}
+		resolve_cache_store(data, abspath, maycreat, resolve, r, r < 0 ? NULL : res);
+		if (!r && resolve)
+			prefix_learn(abspath, resolved);
+		if (!r && resolved != box_resbuf)
+			box_reslong = resolved;
+	}
+	histogram_add(&pandora->stats.resolve, start);
+	if (heap)
+		free(heap);
 	return r;
 }
 
 int
 box_match_path(const char *path, const slist_t *patterns, const char **match)
 {
+	int r;
+	unsigned long long start;
 	struct snode *node;
 
+	r = 0;
+	start = stats_now();
 	SLIST_FOREACH(node, patterns, up) {
 		if (wildmatch_ext(node->data, path)) {
 			if (match)
 				*match = node->data;
-			return 1;
+			r = 1;
+			break;
 		}
 	}
+	histogram_add(&pandora->stats.match, start);
+
+	return r;
+}
+
+const slist_t *
+box_path_list(const sandbox_t *box, enum path_list list)
+{
+	switch (list) {
+	case PATH_LIST_WHITELIST_EXEC:
+		return &box->whitelist_exec;
+	case PATH_LIST_WHITELIST_READ:
+		return &box->whitelist_read;
+	case PATH_LIST_WHITELIST_WRITE:
+		return &box->whitelist_write;
+	case PATH_LIST_BLACKLIST_EXEC:
+		return &box->blacklist_exec;
+	case PATH_LIST_BLACKLIST_READ:
+		return &box->blacklist_read;
+	case PATH_LIST_BLACKLIST_WRITE:
+		return &box->blacklist_write;
+	default:
+		abort();
+	}
+}
+
+/* Index of the path list in the sandbox, -1 for other lists like filters */
+int
+box_path_list_index(const sandbox_t *box, const slist_t *patterns)
+{
+	for (int list = 0; list < PATH_LIST_MAX; list++) {
+		if (patterns == box_path_list(box, list))
+			return list;
+	}
+	return -1;
+}
+
+/* Compiled path list, compiling it if it has changed */
+patset_t *
+box_patset(sandbox_t *box, enum path_list list)
+{
+	if (box->patset_stale & (1U << list)) {
+		box->patset[list] = patset_compile(box_path_list(box, list));
+		box->patset_stale &= ~(1U << list);
+	}
+	return box->patset[list];
+}
 
-	return 0;
+/*
+ * Mark the path list as changed. Lists are compiled lazily as magic commands
+ * tend to come in bursts, e.g. while the configuration is read.
+ */
+void
+box_patset_stale(sandbox_t *box, enum path_list list)
+{
+	patset_release(box->patset[list]);
+	box->patset[list] = NULL;
+	box->patset_stale |= 1U << list;
 }
 
 int
 box_check_path(pink_easy_process_t *current, const char *name, sys_info_t *info)
 {
 	int r;
-	char *prefix, *path, *abspath;
+	char *path;
+	const char *prefix, *abspath;
+	resolve_result_t res;
 	pid_t pid = pink_easy_process_get_pid(current);
 	pink_bitness_t bit = pink_easy_process_get_bitness(current);
 	proc_data_t *data = pink_easy_process_get_userdata(current);
@@ -193,7 +325,8 @@ box_check_path(pink_easy_process_t *current, const char *name, sys_info_t *info)
 	assert(current);
 	assert(info);
 
-	prefix = path = abspath = NULL;
+	path = NULL;
+	prefix = abspath = NULL;
 
 	if (info->at && (r = path_prefix(current, info->index - 1, &prefix))) {
 		if (r < 0) {
@@ -216,7 +349,7 @@ box_check_path(pink_easy_process_t *current, const char *name, sys_info_t *info)
 	else if (r /* > 0 */)
 		goto end;
 
-	if ((r = box_resolve_path(path, prefix ? prefix : data->cwd, pid, info->create > 0, info->resolv, &abspath)) < 0) {
+	if ((r = box_resolve_path(path, prefix ? prefix : data->cwd, pid, data, info->create > 0, info->resolv, &res)) < 0) {
 		warning("resolving path:\"%s\" [%s() index:%u prefix:\"%s\"] failed for process:%lu [%s name:\"%s\" cwd:\"%s\"] (errno:%d %s)",
 				path, name, info->index, prefix,
 				(unsigned long)pid, pink_bitness_name(bit),
@@ -228,6 +361,7 @@ box_check_path(pink_easy_process_t *current, const char *name, sys_info_t *info)
 			violation(current, "%s()", name);
 		goto end;
 	}
+	abspath = res.path;
 	debug("resolved path:\"%s\" to absolute path:\"%s\" [name=%s() create=%d resolv=%d] for process:%lu [%s name:\"%s\" cwd:\"%s\"]",
 			path, abspath, name, info->create, info->resolv,
 			(unsigned long)pid, pink_bitness_name(bit),
@@ -241,7 +375,7 @@ box_check_path(pink_easy_process_t *current, const char *name, sys_info_t *info)
 		wblist = &data->config.blacklist_write;
 
 	if (info->whitelisting) {
-		if (box_match_path(abspath, wblist, NULL)) {
+		if (verdict_match(&data->config, wblist, abspath)) {
 			/* Path matches one of the whitelisted path patterns.
 			 * Allow access!
 			 */
@@ -249,7 +383,7 @@ box_check_path(pink_easy_process_t *current, const char *name, sys_info_t *info)
 			goto end;
 		}
 	}
-	else if (!box_match_path(abspath, wblist, NULL)) {
+	else if (!verdict_match(&data->config, wblist, abspath)) {
 		/* Path does not match one of the blacklisted path patterns.
 		 * Allow access
 		 */
@@ -265,12 +399,9 @@ box_check_path(pink_easy_process_t *current, const char *name, sys_info_t *info)
 	}
 
 	if (info->create == 2) {
-		/* The system call *must* create the file */
-		int sr;
-		struct stat buf;
-
-		sr = info->resolv ? stat(abspath, &buf) : lstat(abspath, &buf);
-		if (!sr) {
+		/* The system call *must* create the file,
+		 * resolving the path found out whether it exists. */
+		if (res.type) {
 			/* Yet the file exists... */
 			debug("system call %s() must create existant path:\"%s\" for process:%lu [%s name:\"%s\" cwd:\"%s\"]",
 					name, abspath,
@@ -298,13 +429,10 @@ box_check_path(pink_easy_process_t *current, const char *name, sys_info_t *info)
 	}
 
 end:
-	if (prefix)
-		free(prefix);
-	if (path)
-		free(path);
-	if (abspath)
-		free(abspath);
-
+	if (!r && !data->deny && abspath && info->abspath) {
+		intern_release(*info->abspath);
+		*info->abspath = intern(abspath);
+	}
 	return r;
 }
 
@@ -312,7 +440,8 @@ int
 box_check_sock(pink_easy_process_t *current, const char *name, sys_info_t *info)
 {
 	int r;
-	char *abspath;
+	const char *abspath;
+	resolve_result_t res;
 	struct snode *node;
 	sock_match_t *m;
 	pid_t pid = pink_easy_process_get_pid(current);
@@ -327,9 +456,9 @@ box_check_sock(pink_easy_process_t *current, const char *name, sys_info_t *info)
 	abspath = NULL;
 	psa = xmalloc(sizeof(pink_socket_address_t));
 
-	if (!pink_decode_socket_address(pid, bit, info->index, info->fd, psa)) {
+	if (!mem_decode_socket_address(pid, bit, data, info->index, info->fd, psa)) {
 		if (errno != ESRCH) {
-			warning("pink_decode_socket_address(%lu, \"%s\", %u) failed (errno:%d %s)",
+			warning("mem_decode_socket_address(%lu, \"%s\", %u) failed (errno:%d %s)",
 					(unsigned long)pid,
 					pink_bitness_name(bit),
 					info->index,
@@ -359,7 +488,7 @@ box_check_sock(pink_easy_process_t *current, const char *name, sys_info_t *info)
 
 	if (psa->family == AF_UNIX && *psa->u.sa_un.sun_path != 0) {
 		/* Non-abstract UNIX socket, resolve the path. */
-		if ((r = box_resolve_path(psa->u.sa_un.sun_path, data->cwd, pid, 1, info->resolv, &abspath)) < 0) {
+		if ((r = box_resolve_path(psa->u.sa_un.sun_path, data->cwd, pid, data, 1, info->resolv, &res)) < 0) {
 			warning("resolving path:\"%s\" [%s() index:%u] failed for process:%lu [%s name:\"%s\" cwd:\"%s\"] (errno:%d %s)",
 					psa->u.sa_un.sun_path, name, info->index,
 					(unsigned long)pid, pink_bitness_name(bit),
@@ -371,6 +500,7 @@ box_check_sock(pink_easy_process_t *current, const char *name, sys_info_t *info)
 				violation(current, "%s()", name);
 			goto end;
 		}
+		abspath = res.path;
 
 		SLIST_FOREACH(node, info->wblist, up) {
 			m = node->data;
@@ -425,20 +555,15 @@ report:
 end:
 	if (!r) {
 		if (info->abspath)
-			*info->abspath = abspath;
-		else if (abspath)
-			free(abspath);
+			*info->abspath = abspath ? intern(abspath) : NULL;
 
 		if (info->addr)
 			*info->addr = psa;
 		else
 			free(psa);
 	}
-	else {
-		if (abspath)
-			free(abspath);
+	else
 		free(psa);
-	}
 
 	return r;
 }
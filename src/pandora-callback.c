@@ -119,13 +119,37 @@ callback_error(const pink_easy_context_t *ctx, ...)
 	va_end(ap);
 }
 
+/*
+ * Account for the first stop, or the exit, of a thread attached to at
+ * startup. The attach latency is reported when the last one is seen.
+ */
+static void
+attach_done(pid_t pid)
+{
+	ht_int32_node_t *node;
+
+	if (!pandora->attach_pending)
+		return;
+	if (!(node = hashtable_find(pandora->attach_tids, pid, 0)) || node->data != UINT_TO_PTR(1))
+		return;
+	node->data = UINT_TO_PTR(2);
+
+	if (--pandora->attach_pending)
+		return;
+	info("attached to all threads in %llu usec, up to the last attach stop",
+			(stats_now() - pandora->attach_start) / 1000);
+	hashtable_destroy(pandora->attach_tids);
+	pandora->attach_tids = NULL;
+}
+
 static void
 callback_birth(PINK_GCC_ATTR((unused)) const pink_easy_context_t *ctx, pink_easy_process_t *current, pink_easy_process_t *parent)
 {
 	int r;
 	pid_t pid;
 	pink_bitness_t bit;
-	char *cwd, *comm;
+	char *path;
+	const char *cwd, *comm;
 	struct snode *node, *newnode;
 	proc_data_t *data, *pdata;
 	sandbox_t *inherit;
@@ -133,27 +157,40 @@ callback_birth(PINK_GCC_ATTR((unused)) const pink_easy_context_t *ctx, pink_easy
 	pid = pink_easy_process_get_pid(current);
 	bit = pink_easy_process_get_bitness(current);
 	data = xcalloc(1, sizeof(proc_data_t));
+	data->fd = -1;
+
+	attach_done(pid);
 
 	if (!parent) {
 		pandora->eldest = pid;
 
 		/* Figure out process name */
-		if ((r = proc_comm(pid, &comm))) {
+		if ((r = proc_comm(pid, &path))) {
 			warning("failed to read the name of process:%lu [%s] (errno:%d %s)",
 					(unsigned long)pid, pink_bitness_name(bit),
 					-r, strerror(-r));
-			comm = xstrdup("???");
+			comm = intern("???");
+		}
+		else {
+			comm = intern(path);
+			free(path);
 		}
 
 		/* Figure out the current working directory */
-		if ((r = proc_cwd(pid, &cwd))) {
+		if ((r = proc_cwd(pid, &path))) {
 			warning("failed to get working directory of the initial process:%lu [%s name:\"%s\"] (errno:%d %s)",
 					(unsigned long)pid, pink_bitness_name(bit), comm,
 					-r, strerror(-r));
+			intern_release(comm);
 			free(data);
 			panic(current);
 			return;
 		}
+		cwd = intern(path);
+		free(path);
+
+		/* Threads of attached processes share their file descriptors */
+		data->fd_shared = pink_easy_process_is_attached(current);
 
 		info("initial process:%lu [%s name:\"%s\" cwd:\"%s\"]",
 				(unsigned long)pid, pink_bitness_name(bit),
@@ -163,8 +200,12 @@ callback_birth(PINK_GCC_ATTR((unused)) const pink_easy_context_t *ctx, pink_easy
 	}
 	else {
 		pdata = (proc_data_t *)pink_easy_process_get_userdata(parent);
-		comm = xstrdup(pdata->comm);
-		cwd = xstrdup(pdata->cwd);
+		comm = intern_ref(pdata->comm);
+		cwd = intern_ref(pdata->cwd);
+
+		/* Clones may share the file descriptors of their parent */
+		if (pink_easy_process_is_clone(current))
+			data->fd_shared = pdata->fd_shared = true;
 
 		info("new process:%lu [%s name:\"%s\" cwd:\"%s\"]",
 				(unsigned long)pid, pink_bitness_name(bit),
@@ -183,42 +224,53 @@ callback_birth(PINK_GCC_ATTR((unused)) const pink_easy_context_t *ctx, pink_easy
 	data->config.sandbox_write = inherit->sandbox_write;
 	data->config.sandbox_sock = inherit->sandbox_sock;
 	data->config.magic_lock = inherit->magic_lock;
+	data->config.listhash = inherit->listhash;
 	data->comm = comm;
 	data->cwd = cwd;
 
 	/* Copy the lists  */
-#define SLIST_COPY_ALL(var, head, field, newhead, newvar, copydata)	\
-	do {								\
-		SLIST_INIT(newhead);					\
-		SLIST_FOREACH(var, head, field) {			\
-			newvar = xcalloc(1, sizeof(struct snode));	\
-			newvar->data = copydata(var->data);		\
-			SLIST_INSERT_HEAD(newhead, newvar, field);	\
-		}							\
+#define SLIST_COPY_ALL(var, head, field, newhead, newvar, copydata)		\
+	do {									\
+		SLIST_INIT(newhead);						\
+		SLIST_FOREACH(var, head, field) {				\
+			newvar = xcalloc(1, sizeof(struct snode));		\
+			newvar->data = CONST_TO_PTR(copydata(var->data));	\
+			SLIST_INSERT_HEAD(newhead, newvar, field);		\
+		}								\
 	} while (0)
 
-	SLIST_COPY_ALL(node, &inherit->whitelist_exec, up, &data->config.whitelist_exec, newnode, xstrdup);
-	SLIST_COPY_ALL(node, &inherit->whitelist_read, up, &data->config.whitelist_read, newnode, xstrdup);
-	SLIST_COPY_ALL(node, &inherit->whitelist_write, up, &data->config.whitelist_write, newnode, xstrdup);
+	SLIST_COPY_ALL(node, &inherit->whitelist_exec, up, &data->config.whitelist_exec, newnode, intern_ref);
+	SLIST_COPY_ALL(node, &inherit->whitelist_read, up, &data->config.whitelist_read, newnode, intern_ref);
+	SLIST_COPY_ALL(node, &inherit->whitelist_write, up, &data->config.whitelist_write, newnode, intern_ref);
 	SLIST_COPY_ALL(node, &inherit->whitelist_sock_bind, up, &data->config.whitelist_sock_bind, newnode, sock_match_xdup);
 	SLIST_COPY_ALL(node, &inherit->whitelist_sock_connect, up, &data->config.whitelist_sock_connect, newnode, sock_match_xdup);
 
-	SLIST_COPY_ALL(node, &inherit->blacklist_exec, up, &data->config.blacklist_exec, newnode, xstrdup);
-	SLIST_COPY_ALL(node, &inherit->blacklist_read, up, &data->config.blacklist_read, newnode, xstrdup);
-	SLIST_COPY_ALL(node, &inherit->blacklist_write, up, &data->config.blacklist_write, newnode, xstrdup);
+	SLIST_COPY_ALL(node, &inherit->blacklist_exec, up, &data->config.blacklist_exec, newnode, intern_ref);
+	SLIST_COPY_ALL(node, &inherit->blacklist_read, up, &data->config.blacklist_read, newnode, intern_ref);
+	SLIST_COPY_ALL(node, &inherit->blacklist_write, up, &data->config.blacklist_write, newnode, intern_ref);
 	SLIST_COPY_ALL(node, &inherit->blacklist_sock_bind, up, &data->config.blacklist_sock_bind, newnode, sock_match_xdup);
 	SLIST_COPY_ALL(node, &inherit->blacklist_sock_connect, up, &data->config.blacklist_sock_connect, newnode, sock_match_xdup);
 #undef SLIST_COPY_ALL
 
+	/* Share the compiled path lists, compiling them once in the parent */
+	for (int list = 0; list < PATH_LIST_MAX; list++)
+		data->config.patset[list] = patset_ref(box_patset(inherit, list));
+	data->config.patset_stale = 0;
+	memcpy(data->config.filter, inherit->filter, sizeof(data->config.filter));
+
 	if (pandora->config.whitelist_per_process_directories) {
-#define SLIST_ALLOW_PID(var, head, field, id)							\
-		do {										\
-			var = xcalloc(1, sizeof(struct snode));					\
-			xasprintf((char **)&var->data, "/proc/%lu/***", (unsigned long)id);	\
-			SLIST_INSERT_HEAD(head, var, up);					\
+#define SLIST_ALLOW_PID(var, head, field, str)					\
+		do {								\
+			var = xcalloc(1, sizeof(struct snode));			\
+			var->data = CONST_TO_PTR(intern(str));			\
+			SLIST_INSERT_HEAD(head, var, up);			\
 		} while (0)
-		SLIST_ALLOW_PID(newnode, &data->config.whitelist_read, up, pid);
-		SLIST_ALLOW_PID(newnode, &data->config.whitelist_write, up, pid);
+		xasprintf(&path, "/proc/%lu/***", (unsigned long)pid);
+		SLIST_ALLOW_PID(newnode, &data->config.whitelist_read, up, path);
+		SLIST_ALLOW_PID(newnode, &data->config.whitelist_write, up, path);
+		verdict_filter_update(&data->config.filter[PATH_LIST_WHITELIST_READ], path, 1);
+		verdict_filter_update(&data->config.filter[PATH_LIST_WHITELIST_WRITE], path, 1);
+		free(path);
 #undef SLIST_ALLOW_PID
 	}
 
@@ -229,6 +281,16 @@ callback_birth(PINK_GCC_ATTR((unused)) const pink_easy_context_t *ctx, pink_easy
 	}
 
 	pink_easy_process_set_userdata(current, data, free_proc);
+
+	++pandora->stats.proc_birth;
+	if (++pandora->stats.proc_alive > pandora->stats.proc_alive_max)
+		pandora->stats.proc_alive_max = pandora->stats.proc_alive;
+
+#if PANDORA_HAVE_SECCOMP
+	/* Run freely until the seccomp filter asks us to stop */
+	if (pandora->config.use_seccomp)
+		pink_easy_process_set_step(current, PINK_EASY_STEP_RESUME);
+#endif
 }
 
 static int
@@ -246,6 +308,11 @@ callback_end(PINK_GCC_ATTR((unused)) const pink_easy_context_t *ctx, PINK_GCC_AT
 static int
 callback_pre_exit(PINK_GCC_ATTR((unused)) const pink_easy_context_t *ctx, pid_t pid, unsigned long status)
 {
+	++pandora->stats.proc_exit;
+	if (pandora->stats.proc_alive > 0)
+		--pandora->stats.proc_alive;
+	attach_done(pid);
+
 	if (pid == pandora->eldest) {
 		/* Eldest child, keep return code */
 		if (WIFEXITED(status)) {
@@ -289,12 +356,18 @@ static int
 callback_exec(PINK_GCC_ATTR((unused)) const pink_easy_context_t *ctx, pink_easy_process_t *current, PINK_GCC_ATTR((unused)) pink_bitness_t orig_bitness)
 {
 	int e, r;
-	char *comm;
+	char *name;
+	const char *comm;
 	const char *match;
 	pid_t pid = pink_easy_process_get_pid(current);
 	pink_bitness_t bit = pink_easy_process_get_bitness(current);
 	proc_data_t *data = pink_easy_process_get_userdata(current);
 
+	++pandora->stats.proc_exec;
+
+	/* Forget the file descriptors, close-on-exec flags aren't tracked */
+	fdtable_free(data);
+
 	if (data->config.magic_lock == LOCK_PENDING) {
 		info("locking magic commands for process:%lu [%s name:\"%s\" cwd:\"%s\"]",
 				(unsigned long)pid,
@@ -320,29 +393,33 @@ callback_exec(PINK_GCC_ATTR((unused)) const pink_easy_context_t *ctx, pink_easy_
 	else if (box_match_path(data->abspath, &pandora->config.exec_resume_if_match, &match)) {
 		warning("resume_if_match pattern `%s' matches execve path `%s'", match, data->abspath);
 		warning("resuming process:%lu [%s cwd:\"%s\"]", (unsigned long)pid, pink_bitness_name(bit), data->cwd);
+		pandora->untraced = true;
 		if (!pink_easy_process_resume(current, 0))
 			warning("failed to resume process:%lu (errno:%d %s)", (unsigned long)pid, errno, strerror(errno));
 		r = PINK_EASY_CFLAG_DROP;
 	}
 
 	/* Update process name */
-	if ((e = basename_alloc(data->abspath, &comm))) {
+	if ((e = basename_alloc(data->abspath, &name))) {
 		warning("failed to update name of process:%lu [%s name:\"%s\" cwd:\"%s\"] (errno:%d %s)",
 				(unsigned long)pid, pink_bitness_name(bit),
 				data->comm, data->cwd,
 				-e, strerror(-e));
-		comm = xstrdup("???");
+		comm = intern("???");
+	}
+	else {
+		comm = intern(name);
+		free(name);
+		if (comm != data->comm)
+			info("updating name of process:%lu [%s name:\"%s\" cwd:\"%s\"] to \"%s\" due to execve()",
+					(unsigned long)pid, pink_bitness_name(bit),
+					data->comm, data->cwd, comm);
 	}
-	else if (strcmp(comm, data->comm))
-		info("updating name of process:%lu [%s name:\"%s\" cwd:\"%s\"] to \"%s\" due to execve()",
-				(unsigned long)pid, pink_bitness_name(bit),
-				data->comm, data->cwd, comm);
 
-	if (data->comm)
-		free(data->comm);
+	intern_release(data->comm);
 	data->comm = comm;
 
-	free(data->abspath);
+	intern_release(data->abspath);
 	data->abspath = NULL;
 
 	return r;
@@ -351,8 +428,67 @@ callback_exec(PINK_GCC_ATTR((unused)) const pink_easy_context_t *ctx, pink_easy_
 static int
 callback_syscall(PINK_GCC_ATTR((unused)) const pink_easy_context_t *ctx, pink_easy_process_t *current, bool entering)
 {
-	return entering ? sysenter(current) : sysexit(current);
+#if PANDORA_HAVE_SECCOMP
+	if (pandora->config.use_seccomp) {
+		int r;
+		proc_data_t *data = pink_easy_process_get_userdata(current);
+
+		/* System call entry has been handled at the seccomp stop, only
+		 * its exit stop is of interest. Older kernels report the entry
+		 * stop after the seccomp stop, skip it. */
+		if (!data->seccomp_exit) {
+			pink_easy_process_set_step(current, PINK_EASY_STEP_RESUME);
+			return 0;
+		}
+		if (data->seccomp_entry) {
+			data->seccomp_entry = false;
+			return 0;
+		}
+		data->seccomp_exit = false;
+
+		++pandora->stats.sys_exit;
+		r = sysexit(current);
+		if (!(r & PINK_EASY_CFLAG_DROP))
+			pink_easy_process_set_step(current, PINK_EASY_STEP_RESUME);
+		return r;
+	}
+#endif
+	if (entering) {
+		++pandora->stats.sys_enter;
+		return sysenter(current);
+	}
+	++pandora->stats.sys_exit;
+	return sysexit(current);
+}
+
+#if PANDORA_HAVE_SECCOMP
+static int
+callback_seccomp(PINK_GCC_ATTR((unused)) const pink_easy_context_t *ctx, pink_easy_process_t *current, PINK_GCC_ATTR((unused)) long ret_data)
+{
+	int r;
+	bool exit_stop;
+	proc_data_t *data = pink_easy_process_get_userdata(current);
+
+	++pandora->stats.sys_enter;
+	r = sysenter(current);
+	if (r & PINK_EASY_CFLAG_DROP)
+		return r;
+
+	r = sysenter_done(current, &exit_stop);
+	if (r & PINK_EASY_CFLAG_DROP)
+		return r;
+
+	if (exit_stop) {
+		/* Stop at system call exit to run the exit handler */
+		data->seccomp_exit = true;
+		data->seccomp_entry = pandora->seccomp_entry_stop;
+		pink_easy_process_set_step(current, PINK_EASY_STEP_SYSCALL);
+	}
+	else
+		++pandora->stats.sys_exit_skip;
+	return r;
 }
+#endif
 
 void
 callback_init(void)
@@ -364,6 +500,9 @@ callback_init(void)
 	pandora->callback_table.pre_exit = callback_pre_exit;
 	pandora->callback_table.exec = callback_exec;
 	pandora->callback_table.syscall = callback_syscall;
+#if PANDORA_HAVE_SECCOMP
+	pandora->callback_table.seccomp = callback_seccomp;
+#endif
 	pandora->callback_table.error = callback_error;
 	pandora->callback_table.cerror = callback_child_error;
 }
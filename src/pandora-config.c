@@ -189,6 +189,9 @@ config_init(void)
 	pandora->config.log_timestamp = true;
 	pandora->config.follow_fork = 1;
 	pandora->config.exit_wait_all = 1;
+	pandora->config.track_fds = false;
+	pandora->config.use_openat2 = false;
+	pandora->config.use_seccomp = false;
 	pandora->config.whitelist_per_process_directories = true;
 	pandora->config.whitelist_successful_bind = true;
 	pandora->config.whitelist_unsupported_socket_families = true;
@@ -0,0 +1,211 @@
+/* vim: set cino= fo=croql sw=8 ts=8 sts=0 noet cin fdm=syntax : */
+
+/*
+ * Copyright (c) 2011 Ali Polatel <alip@exherbo.org>
+ *
+ * This file is part of Pandora's Box. pandora is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * pandora is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "pandora-defs.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "file.h"
+#include "hashtable.h"
+#include "util.h"
+
+/*
+ * Canonicalizing a path looks up every component of it, so all processes
+ * keep looking up /usr, /usr/include and so on. The results of lstat() and
+ * readlink() on the components are cached here, shared by all processes of
+ * the tracer.
+ *
+ * Entries recording that a component doesn't exist or can't be looked up are
+ * valid until a traced process creates a file or changes permissions, owners
+ * or extended attributes, which may hold access control lists. Entries of
+ * existing components are valid until a traced process removes or renames a
+ * file or changes the mounts. See the generation numbers in pandora_t, which
+ * are incremented at system call exit. Like the entries of the per-process
+ * resolution cache they expire, as changes made by processes which aren't
+ * traced go unnoticed, see pandora-resolve.c. Components under /proc are never
+ * cached.
+ *
+ * The table is a cache keyed by a hash of the path, see hashtable.h.
+ */
+#define DCACHE_MAX	65536
+
+typedef struct {
+	char *path;
+
+	/* Generation numbers at the time of the lookup */
+	unsigned long resolve_gen;
+	unsigned long remove_gen;
+
+	/* Result of lstat(), errno is zero if the component exists */
+	int error;
+	mode_t mode;
+	dev_t dev;
+	ino_t ino;
+
+	/* Target of symbolic links, read on first use */
+	char *target;
+} dentry_t;
+
+static hashtable_t *dcache;
+
+static void
+dentry_free(void *data)
+{
+	dentry_t *entry = data;
+
+	if (!entry)
+		return;
+	if (entry->path)
+		free(entry->path);
+	if (entry->target)
+		free(entry->target);
+	free(entry);
+}
+
+static bool
+dentry_valid(const dentry_t *entry, const char *path)
+{
+	if (entry->remove_gen != pandora->remove_gen)
+		return false;
+	if (entry->error && entry->resolve_gen != pandora->resolve_gen)
+		return false;
+	return streq(entry->path, path);
+}
+
+void
+dcache_free(void)
+{
+	hashtable_cache_free(&dcache, dentry_free);
+}
+
+/* Look up the cached entry of the path, or make a new one using lstat() */
+static dentry_t *
+dcache_lookup(const char *path, bool count)
+{
+	int r;
+	struct stat st;
+	dentry_t *entry;
+	ht_int64_node_t *node;
+
+	if ((r = hashtable_cache_prepare(&dcache, 1024, DCACHE_MAX, dentry_free)) < 0) {
+		errno = -r;
+		die_errno(-1, "hashtable_create");
+	}
+
+	if (!(node = hashtable_find(dcache, hash_str(path), 1)))
+		die_errno(-1, "hashtable_find");
+
+	entry = node->data;
+	if (entry && dentry_valid(entry, path)) {
+		if (count)
+			++pandora->stats.dcache_hit;
+		return entry;
+	}
+	if (count)
+		++pandora->stats.dcache_miss;
+
+	dentry_free(entry);
+	entry = xcalloc(1, sizeof(dentry_t));
+	entry->path = xstrdup(path);
+	entry->resolve_gen = pandora->resolve_gen;
+	entry->remove_gen = pandora->remove_gen;
+	if (lstat(path, &st) < 0)
+		entry->error = errno;
+	else {
+		entry->mode = st.st_mode;
+		entry->dev = st.st_dev;
+		entry->ino = st.st_ino;
+	}
+	node->data = entry;
+
+	return entry;
+}
+
+static bool
+dcache_cacheable(const char *path)
+{
+	return !startswith(path, "/proc") || (path[5] != '/' && path[5] != '\0');
+}
+
+/* lstat() replacement for canonicalize_filename_mode(), fills in the file
+ * type, the device and the inode only */
+int
+dcache_lstat(const char *path, struct stat *buf)
+{
+	const dentry_t *entry;
+
+	if (!dcache_cacheable(path))
+		return lstat(path, buf);
+
+	entry = dcache_lookup(path, true);
+	if (entry->error) {
+		errno = entry->error;
+		return -1;
+	}
+
+	memset(buf, 0, sizeof(struct stat));
+	buf->st_mode = entry->mode;
+	buf->st_dev = entry->dev;
+	buf->st_ino = entry->ino;
+	return 0;
+}
+
+/* readlink() replacement for canonicalize_filename_mode() */
+ssize_t
+dcache_readlink(const char *path, char *buf, size_t size)
+{
+	int r;
+	size_t len;
+	dentry_t *entry;
+
+	if (!dcache_cacheable(path))
+		return readlink(path, buf, size);
+
+	/* The component has just been looked up by lstat */
+	entry = dcache_lookup(path, false);
+	if (entry->error) {
+		errno = entry->error;
+		return -1;
+	}
+	if (!S_ISLNK(entry->mode)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (!entry->target) {
+		if ((r = readlink_alloc(path, &entry->target)) < 0) {
+			errno = -r;
+			return -1;
+		}
+	}
+
+	/* Truncated like readlink() */
+	len = strlen(entry->target);
+	if (len > size)
+		len = size;
+	memcpy(buf, entry->target, len);
+	return len;
+}
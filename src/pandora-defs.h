@@ -35,13 +35,23 @@
 #include <assert.h>
 #include <stdarg.h>
 #include <stdbool.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
 #include <sys/queue.h>
 #include <sys/types.h>
+#include <sys/stat.h>
 
 #include <netinet/in.h>
 #include <sys/un.h>
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <sys/user.h>
+#define PANDORA_HAVE_REGS 1
+#else
+#define PANDORA_HAVE_REGS 0
+#endif
+
 #include <pinktrace/pink.h>
 #include <pinktrace/easy/pink.h>
 
@@ -102,6 +112,17 @@ enum create_mode {
 	MUST_CREATE,
 };
 
+/* How a system call changes the file system namespace */
+enum mutate_mode {
+	MUTATE_NONE = 0,
+	MUTATE_CREATE,	/* adds names */
+	MUTATE_REMOVE,	/* removes or replaces names */
+	MUTATE_OPEN,	/* with O_CREAT in the second argument */
+	MUTATE_OPENAT,	/* with O_CREAT in the third argument */
+	MUTATE_SOCKETCALL,	/* when the subcall is bind() */
+	MUTATE_ATTR,	/* changes permissions or owners */
+};
+
 enum lock_state {
 	LOCK_UNSET,
 	LOCK_SET,
@@ -114,6 +135,17 @@ static const char *const lock_state_table[] = {
 };
 DEFINE_STRING_TABLE_LOOKUP(lock_state, int)
 
+/* Path lists of a sandbox, see box_path_list() */
+enum path_list {
+	PATH_LIST_WHITELIST_EXEC,
+	PATH_LIST_WHITELIST_READ,
+	PATH_LIST_WHITELIST_WRITE,
+	PATH_LIST_BLACKLIST_EXEC,
+	PATH_LIST_BLACKLIST_READ,
+	PATH_LIST_BLACKLIST_WRITE,
+	PATH_LIST_MAX,
+};
+
 enum abort_decision {
 	ABORT_KILLALL,
 	ABORT_CONTALL,
@@ -175,6 +207,7 @@ enum magic_key {
 	MAGIC_KEY_CORE_LOG_CONSOLE_FD,
 	MAGIC_KEY_CORE_LOG_FILE,
 	MAGIC_KEY_CORE_LOG_LEVEL,
+	MAGIC_KEY_CORE_LOG_STATS_FILE,
 	MAGIC_KEY_CORE_LOG_TIMESTAMP,
 
 	MAGIC_KEY_CORE_SANDBOX,
@@ -205,6 +238,9 @@ enum magic_key {
 	MAGIC_KEY_CORE_TRACE_FOLLOW_FORK,
 	MAGIC_KEY_CORE_TRACE_EXIT_WAIT_ALL,
 	MAGIC_KEY_CORE_TRACE_MAGIC_LOCK,
+	MAGIC_KEY_CORE_TRACE_TRACK_FDS,
+	MAGIC_KEY_CORE_TRACE_USE_OPENAT2,
+	MAGIC_KEY_CORE_TRACE_USE_SECCOMP,
 
 	MAGIC_KEY_EXEC,
 	MAGIC_KEY_EXEC_KILL_IF_MATCH,
@@ -244,11 +280,12 @@ enum magic_error {
 	MAGIC_ERROR_INVALID_OPERATION = -5,
 	MAGIC_ERROR_NOPERM = -6,
 	MAGIC_ERROR_OOM = -7,
+	MAGIC_ERROR_NOT_SUPPORTED = -8,
 };
 
 /* Type declarations */
 typedef struct {
-	char *path;
+	const char *path;
 	pink_socket_address_t *addr;
 } sock_info_t;
 
@@ -280,6 +317,19 @@ typedef struct {
 	} match;
 } sock_match_t;
 
+typedef struct patset patset_t;
+
+/* Filter of the literal prefixes of a path list, see pandora-verdict.c */
+#define VERDICT_FILTER_DEPTH	4
+#define VERDICT_FILTER_SIZE	512
+typedef struct {
+	/* Patterns with no literal directory to start with */
+	unsigned wild;
+
+	/* Counts of patterns per hash of the prefix, 255 sticks */
+	unsigned char count[VERDICT_FILTER_SIZE];
+} verdict_filter_t;
+
 typedef struct {
 	enum sandbox_mode sandbox_exec;
 	enum sandbox_mode sandbox_read;
@@ -299,8 +349,47 @@ typedef struct {
 	slist_t blacklist_write;
 	slist_t blacklist_sock_bind;
 	slist_t blacklist_sock_connect;
+
+	/* Hash of the path lists, see pandora-verdict.c */
+	unsigned long long listhash;
+
+	/* Compiled path lists, see pandora-patset.c. Lists whose bit is set
+	 * in patset_stale have changed and are compiled on first use. */
+	patset_t *patset[PATH_LIST_MAX];
+	unsigned patset_stale;
+
+	/* Filters of the path lists, updated as patterns come and go */
+	verdict_filter_t filter[PATH_LIST_MAX];
 } sandbox_t;
 
+typedef struct {
+	/* Hash of the path and the resolution mode, path is NULL for empty entries */
+	unsigned long hash;
+	unsigned long gen;
+	short mode;
+
+	/* Absolute path and its resolved form, NULL if resolving failed.
+	 * Both live in a single buffer of the given size, reused by the
+	 * entries replacing this one. */
+	char *path;
+	char *res;
+	size_t size;
+	int ret;
+
+	/* Type of the resolved file, zero if it doesn't exist */
+	mode_t ftype;
+} resolve_entry_t;
+
+/* Result of resolving a path, see box_resolve_path() */
+typedef struct {
+	/* Resolved path, valid until the next resolution */
+	const char *path;
+
+	/* Type of the file found while resolving, the S_IFMT bits of its mode,
+	 * zero if it doesn't exist */
+	mode_t type;
+} resolve_result_t;
+
 typedef struct {
 	/* Last system call */
 	unsigned long sno;
@@ -311,21 +400,66 @@ typedef struct {
 	/* Arguments of last system call */
 	long args[PINK_MAX_INDEX];
 
+#if PANDORA_HAVE_REGS
+	/* Registers at the last system call entry */
+	struct user_regs_struct regs;
+#endif
+
+	/* File descriptor argument of the last system call for the exit
+	 * handler, -1 if the exit handler has nothing to do */
+	long fd;
+
 	/* Is the last system call denied? */
 	bool deny;
 
+#if PANDORA_HAVE_SECCOMP
+	/* Is the process stepping from a seccomp stop to the exit stop of the
+	 * system call, and is there an entry stop to skip on the way? Tracked
+	 * here as the entry/exit toggle of pinktrace doesn't know about
+	 * seccomp stops. */
+	bool seccomp_exit;
+	bool seccomp_entry;
+#endif
+
+	/* Does the last system call change the file system namespace?
+	 * Path resolution caches are invalidated at its exit. */
+	bool mutate;
+
+	/* Flags of the last system call if it opens a directory, 0 otherwise.
+	 * Its file descriptor is remembered at its exit. */
+	long opendir;
+
+	/* Path of the directory, resolved at its entry, interned */
+	const char *opendir_path;
+
+	/* New working directory of the last chdir() or fchdir(), figured out
+	 * at its entry and used at its exit if it succeeds, interned */
+	const char *chdir_path;
+
 	/* Denied system call will return this value */
 	long ret;
 
-	/* Resolved path argument for specially treated system calls like execve() */
-	char *abspath;
+	/* Does process_vm_readv() fail with EPERM for this process? Its memory
+	 * is then read with PTRACE_PEEKDATA only. */
+	bool vm_readv_eperm;
 
-	/* Current working directory, read from /proc/$pid/cwd */
-	char *cwd;
+	/* Buffer to decode path arguments into, reused between system calls */
+	char *membuf;
+	size_t membuf_size;
+
+	/* Path resolution cache, allocated on first use */
+	resolve_entry_t *rcache;
+
+	/* Resolved path argument for specially treated system calls like
+	 * execve(), interned, see pandora-intern.c */
+	const char *abspath;
+
+	/* Current working directory, interned */
+	const char *cwd;
 
 	/* Process name, read from /proc/$pid/comm for initial process and
-	 * updated after successful execve() */
-	char *comm;
+	 * updated after successful execve(), interned */
+	const char *comm;
 
 	/* Information about the last bind address with port zero */
 	sock_info_t *savebind;
@@ -333,6 +467,13 @@ typedef struct {
 	/* fd -> sock_info_t mappings  */
 	hashtable_t *sockmap;
 
+	/* fd -> directory path mappings, allocated on first use */
+	hashtable_t *fdmap;
+
+	/* May the file descriptor table be shared with another process? The
+	 * mappings above aren't used then, see pandora-fd.c */
+	bool fd_shared;
+
 	/* Per-process configuration */
 	sandbox_t config;
 } proc_data_t;
@@ -353,6 +494,7 @@ typedef struct {
 	unsigned log_level;
 	bool log_timestamp;
 	char *log_file;
+	char *stats_file;
 
 	bool whitelist_per_process_directories;
 	bool whitelist_successful_bind;
@@ -370,6 +512,9 @@ typedef struct {
 
 	bool follow_fork;
 	bool exit_wait_all;
+	bool track_fds;
+	bool use_openat2;
+	bool use_seccomp;
 
 	slist_t exec_kill_if_match;
 	slist_t exec_resume_if_match;
@@ -380,6 +525,93 @@ typedef struct {
 	slist_t filter_sock;
 } config_t;
 
+/* Bucket n of a latency histogram counts durations of [2^n, 2^(n+1))
+ * nanoseconds, the last bucket counts everything longer. */
+#define HISTOGRAM_BUCKETS 32
+
+typedef struct {
+	unsigned long long count;
+	unsigned long long total;
+	unsigned long long bucket[HISTOGRAM_BUCKETS];
+} histogram_t;
+
+typedef struct {
+	/* Number of times the system call was denied */
+	unsigned long long denied;
+
+	/* Time from the system call entry stop until the process is resumed */
+	histogram_t enter;
+
+	/* Time spent in the entry handler */
+	histogram_t handler;
+
+	/* Time from the system call exit stop until the process is resumed */
+	histogram_t exit;
+} sysstat_t;
+
+typedef struct {
+	/* System call entries handled */
+	unsigned long long sys_enter;
+
+	/* System call exit stops handled */
+	unsigned long long sys_exit;
+
+	/* System call exit stops avoided */
+	unsigned long long sys_exit_skip;
+
+	/* Process births, successful execve() calls and exits */
+	unsigned long long proc_birth;
+	unsigned long long proc_exec;
+	unsigned long long proc_exit;
+
+	/* Processes traced right now and the most traced at once */
+	unsigned long proc_alive;
+	unsigned long proc_alive_max;
+
+	/* Path arguments decoded */
+	unsigned long long mem_paths;
+
+	/* System calls made to read tracee memory */
+	unsigned long long mem_syscalls;
+
+	/* System calls reading tracee memory would cost with PTRACE_PEEKDATA */
+	unsigned long long mem_peeks;
+
+	/* Path resolution cache hits and misses */
+	unsigned long long resolve_hit;
+	unsigned long long resolve_miss;
+
+	/* Paths resolved with openat2() */
+	unsigned long long resolve_openat2;
+
+	/* Paths found to be canonical without resolving them */
+	unsigned long long resolve_lazy;
+
+	/* Path component cache hits and misses */
+	unsigned long long dcache_hit;
+	unsigned long long dcache_miss;
+
+	/* Directory file descriptor table hits and misses */
+	unsigned long long fd_hit;
+	unsigned long long fd_miss;
+
+	/* Pattern matching verdict cache hits and misses */
+	unsigned long long verdict_hit;
+	unsigned long long verdict_miss;
+
+	/* Paths rejected by the filters of the path lists without matching */
+	unsigned long long verdict_filtered;
+
+	/* Pattern set DFA states built, and matches falling back to wildmatch
+	 * because the DFA of the set grew too large */
+	unsigned long long patset_dfa_states;
+	unsigned long long patset_fallback;
+
+	/* Time spent resolving paths and matching them against patterns */
+	histogram_t resolve;
+	histogram_t match;
+} stats_t;
+
 typedef struct {
 	/* Eldest child */
 	pid_t eldest;
@@ -390,6 +622,12 @@ typedef struct {
 	/* This is true if an access violation has occured, false otherwise. */
 	bool violation;
 
+#if PANDORA_HAVE_SECCOMP
+	/* Does the kernel report the system call entry stop after the seccomp
+	 * stop? See seccomp_entry_stop_follows(). */
+	bool seccomp_entry_stop;
+#endif
+
 	/* Callback table */
 	pink_easy_callback_table_t callback_table;
 
@@ -398,6 +636,28 @@ typedef struct {
 
 	/* Global configuration */
 	config_t config;
+
+	/* Generation of path resolution cache entries, incremented when a
+	 * traced process changes the file system namespace */
+	unsigned long resolve_gen;
+
+	/* Incremented when a traced process removes or replaces names */
+	unsigned long remove_gen;
+
+	/* When the generations were last incremented, and whether processes
+	 * which aren't traced may change the file system namespace, see
+	 * sysenter() */
+	unsigned long long gen_start;
+	bool untraced;
+
+	/* Threads attached to at startup, their number whose attach stop is
+	 * yet to come and when attaching started, see pandora_attach_all() */
+	hashtable_t *attach_tids;
+	unsigned attach_pending;
+	unsigned long long attach_start;
+
+	/* Statistics */
+	stats_t stats;
 } pandora_t;
 
 typedef int (*sysfunc_t) (pink_easy_process_t *current, const char *name);
@@ -406,6 +666,7 @@ typedef struct {
 	const char *name;
 	sysfunc_t enter;
 	sysfunc_t exit;
+	enum mutate_mode mutate;
 } sysentry_t;
 
 typedef struct {
@@ -424,7 +685,7 @@ typedef struct {
 	slist_t *filter;
 
 	long *fd;
-	char **abspath;
+	const char **abspath;
 	pink_socket_address_t **addr;
 } sys_info_t;
 
@@ -460,6 +721,7 @@ void log_msg(unsigned level, const char *fmt, ...) PINK_GCC_ATTR((format (printf
 void abort_all(void);
 int deny(pink_easy_process_t *current);
 int restore(pink_easy_process_t *current);
+int skip(pink_easy_process_t *current);
 int panic(pink_easy_process_t *current);
 int violation(pink_easy_process_t *current, const char *fmt, ...) PINK_GCC_ATTR((format (printf, 2, 3)));
 
@@ -487,21 +749,82 @@ void config_parse_spec(const char *filename) PINK_GCC_ATTR((nonnull(1)));
 
 void callback_init(void);
 
-int box_resolve_path(const char *path, const char *prefix, pid_t pid, int maycreat, int resolve, char **res);
+int box_resolve_path(const char *path, const char *prefix, pid_t pid, proc_data_t *data, int maycreat, int resolve, resolve_result_t *res);
 int box_match_path(const char *path, const slist_t *patterns, const char **match);
+const slist_t *box_path_list(const sandbox_t *box, enum path_list list);
+int box_path_list_index(const sandbox_t *box, const slist_t *patterns);
+patset_t *box_patset(sandbox_t *box, enum path_list list);
+void box_patset_stale(sandbox_t *box, enum path_list list);
 int box_check_path(pink_easy_process_t *current, const char *name, sys_info_t *info);
 int box_check_sock(pink_easy_process_t *current, const char *name, sys_info_t *info);
 
+bool mem_read(pid_t pid, long addr, proc_data_t *data, void *dest, size_t len);
+bool mem_read_string(pid_t pid, long addr, proc_data_t *data, char **buf);
+bool mem_decode_string(pid_t pid, proc_data_t *data, unsigned ind, char **buf);
+bool mem_decode_socket_address(pid_t pid, pink_bitness_t bit, proc_data_t *data,
+		unsigned ind, long *fd_r, pink_socket_address_t *psa);
+
+bool resolve_cache_lookup(proc_data_t *data, const char *path, int maycreat, int resolve,
+		int *ret, resolve_result_t *res);
+void resolve_cache_store(proc_data_t *data, const char *path, int maycreat, int resolve,
+		int ret, const resolve_result_t *res);
+void resolve_cache_free(proc_data_t *data);
+
+int dcache_lstat(const char *path, struct stat *buf);
+ssize_t dcache_readlink(const char *path, char *buf, size_t size);
+void dcache_free(void);
+
+bool prefix_resolve(const char *path, int maycreat, int resolve, int *ret, mode_t *ftype);
+void prefix_learn(const char *path, const char *res);
+void prefix_free(void);
+
+int verdict_match(sandbox_t *box, const slist_t *patterns, const char *path);
+void verdict_rehash(sandbox_t *box);
+void verdict_filter_update(verdict_filter_t *filter, const char *pattern, int delta);
+void verdict_free(void);
+
+patset_t *patset_compile(const slist_t *patterns);
+patset_t *patset_ref(patset_t *set);
+void patset_release(patset_t *set);
+int patset_match(patset_t *set, const char *path, const char **match);
+void patset_free(void);
+
+const char *intern(const char *str);
+const char *intern_ref(const char *str);
+unsigned long intern_id(const char *str);
+void intern_release(const char *str);
+void intern_free(void);
+
+int fdtable_lookup(proc_data_t *data, long fd, const char **buf);
+void fdtable_learn(pid_t pid, proc_data_t *data, long fd, const char *path);
+void fdtable_dup(proc_data_t *data, long oldfd, long newfd);
+void fdtable_close(proc_data_t *data, unsigned long first, unsigned long last);
+void fdtable_free(proc_data_t *data);
+int fdtable_opendir(pink_easy_process_t *current);
+
+bool regs_get(pid_t pid, pink_bitness_t bit, proc_data_t *data);
+bool regs_set(pid_t pid, pink_bitness_t bit, proc_data_t *data, long no, bool ret_set, long ret);
+
 int path_decode(pink_easy_process_t *current, unsigned ind, char **buf);
-int path_prefix(pink_easy_process_t *current, unsigned ind, char **buf);
+int path_prefix(pink_easy_process_t *current, unsigned ind, const char **buf);
 
 void systable_init(void);
 void systable_free(void);
-void systable_add(const char *name, sysfunc_t fenter, sysfunc_t fexit);
+void systable_add(const sysentry_t *entry);
+unsigned systable_list(pink_bitness_t bit, long **list);
 const sysentry_t *systable_lookup(long no, pink_bitness_t bit);
+sysstat_t *systable_stat(long no, pink_bitness_t bit);
+typedef void (*systable_walk_func_t) (const sysentry_t *entry, long no, pink_bitness_t bit,
+		const sysstat_t *stat, void *userdata);
+void systable_walk(systable_walk_func_t func, void *userdata);
+
+void histogram_add(histogram_t *h, unsigned long long start);
+void stats_dump(FILE *fp);
+int stats_write_json(const char *path);
 
 void sysinit(void);
 int sysenter(pink_easy_process_t *current);
+int sysenter_done(pink_easy_process_t *current, bool *exit_stop);
 int sysexit(pink_easy_process_t *current);
 
 int sys_chmod(pink_easy_process_t *current, const char *name);
@@ -512,7 +835,9 @@ int sys_fchownat(pink_easy_process_t *current, const char *name);
 int sys_open(pink_easy_process_t *current, const char *name);
 int sys_openat(pink_easy_process_t *current, const char *name);
 int sys_creat(pink_easy_process_t *current, const char *name);
+int sys_chdir(pink_easy_process_t *current, const char *name);
 int sys_close(pink_easy_process_t *current, const char *name);
+int sys_close_range(pink_easy_process_t *current, const char *name);
 int sys_mkdir(pink_easy_process_t *current, const char *name);
 int sys_mkdirat(pink_easy_process_t *current, const char *name);
 int sys_mknod(pink_easy_process_t *current, const char *name);
@@ -570,8 +895,7 @@ free_sock_info(void *data)
 {
 	sock_info_t *info = data;
 
-	if (info->path)
-		free(info->path);
+	intern_release(info->path);
 	free(info->addr);
 	free(info);
 }
@@ -595,17 +919,35 @@ free_sandbox(sandbox_t *box)
 {
 	struct snode *node;
 
-	SLIST_FLUSH(node, &box->whitelist_exec, up, free);
-	SLIST_FLUSH(node, &box->whitelist_read, up, free);
-	SLIST_FLUSH(node, &box->whitelist_write, up, free);
+	SLIST_FLUSH(node, &box->whitelist_exec, up, intern_release);
+	SLIST_FLUSH(node, &box->whitelist_read, up, intern_release);
+	SLIST_FLUSH(node, &box->whitelist_write, up, intern_release);
 	SLIST_FLUSH(node, &box->whitelist_sock_bind, up, free_sock_match);
 	SLIST_FLUSH(node, &box->whitelist_sock_connect, up, free_sock_match);
 
-	SLIST_FLUSH(node, &box->blacklist_exec, up, free);
-	SLIST_FLUSH(node, &box->blacklist_read, up, free);
-	SLIST_FLUSH(node, &box->blacklist_write, up, free);
+	SLIST_FLUSH(node, &box->blacklist_exec, up, intern_release);
+	SLIST_FLUSH(node, &box->blacklist_read, up, intern_release);
+	SLIST_FLUSH(node, &box->blacklist_write, up, intern_release);
 	SLIST_FLUSH(node, &box->blacklist_sock_bind, up, free_sock_match);
 	SLIST_FLUSH(node, &box->blacklist_sock_connect, up, free_sock_match);
+
+	for (unsigned i = 0; i < PATH_LIST_MAX; i++) {
+		patset_release(box->patset[i]);
+		box->patset[i] = NULL;
+	}
+	box->patset_stale = 0;
+	memset(box->filter, 0, sizeof(box->filter));
+}
+
+/* Current time for latency statistics, in nanoseconds */
+inline
+static unsigned long long
+stats_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
 }
 
 inline
@@ -617,14 +959,17 @@ free_proc(void *data)
 	if (!p)
 		return;
 
-	if (p->abspath)
-		free(p->abspath);
+	intern_release(p->abspath);
+	intern_release(p->opendir_path);
+	intern_release(p->chdir_path);
 
-	if (p->cwd)
-		free(p->cwd);
+	if (p->membuf)
+		free(p->membuf);
 
-	if (p->comm)
-		free(p->comm);
+	resolve_cache_free(p);
+
+	intern_release(p->cwd);
+	intern_release(p->comm);
 
 	if (p->savebind)
 		free_sock_info(p->savebind);
@@ -637,6 +982,8 @@ free_proc(void *data)
 	}
 	hashtable_destroy(p->sockmap);
 
+	fdtable_free(p);
+
 	/* Free the sandbox */
 	free_sandbox(&p->config);
 
@@ -651,8 +998,15 @@ clear_proc(void *data)
 	proc_data_t *p = data;
 
 	p->deny = false;
+	p->mutate = false;
+	p->opendir = 0;
+	intern_release(p->opendir_path);
+	p->opendir_path = NULL;
+	intern_release(p->chdir_path);
+	p->chdir_path = NULL;
 	p->ret = 0;
 	p->subcall = 0;
+	p->fd = -1;
 	for (unsigned i = 0; i < PINK_MAX_INDEX; i++)
 		p->args[i] = 0;
 
@@ -0,0 +1,249 @@
+/* vim: set cino= fo=croql sw=8 ts=8 sts=0 noet cin fdm=syntax : */
+
+/*
+ * Copyright (c) 2011 Ali Polatel <alip@exherbo.org>
+ *
+ * This file is part of Pandora's Box. pandora is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * pandora is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "pandora-defs.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <pinktrace/pink.h>
+#include <pinktrace/easy/pink.h>
+
+#include "hashtable.h"
+
+/*
+ * The directory file descriptor arguments of *at() system calls are resolved
+ * by reading /proc/$pid/fd/$fd, which costs an allocation and a readlink() or
+ * more per call. With core/trace/track_fds the paths of directory file
+ * descriptors are kept per process instead. They are learned at the exit of
+ * open() calls with O_DIRECTORY, under the path resolved while checking them,
+ * and whenever /proc is read, and are copied by dup() and fcntl(F_DUPFD).
+ *
+ * Entries are used without looking at /proc again, checking the file
+ * descriptor with a stat() of /proc/$pid/fd/$fd costs about as much as reading
+ * the link. So every way a file descriptor number gets reused must be seen:
+ * close() and close_range() are stopped for if core/trace/track_fds is set at
+ * startup, dup2() and friends replace the entry of the new file descriptor,
+ * and execve() drops the whole table as close-on-exec flags aren't tracked.
+ * Processes which may share their file descriptor table with another, clones
+ * and processes attached to with -p, don't use the table. Entries of renamed
+ * directories are dropped like the path resolution caches, see
+ * pandora-resolve.c.
+ */
+typedef struct {
+	char *path;
+	unsigned long remove_gen;
+} fd_info_t;
+
+static void
+free_fd_info(fd_info_t *info)
+{
+	if (!info)
+		return;
+	if (info->path)
+		free(info->path);
+	free(info);
+}
+
+static int
+fdtable_stat(pid_t pid, long fd, struct stat *buf)
+{
+	char proc[sizeof("/proc//fd/") + sizeof(long) * 3 * 2];
+
+	snprintf(proc, sizeof(proc), "/proc/%lu/fd/%ld", (unsigned long)pid, fd);
+	return stat(proc, buf) < 0 ? -errno : 0;
+}
+
+static ht_int64_node_t *
+fdtable_node(proc_data_t *data, long fd, bool create)
+{
+	int r;
+	ht_int64_node_t *node;
+
+	if (!data->fdmap) {
+		if (!create)
+			return NULL;
+		if ((r = hashtable_create(16, 1, &data->fdmap)) < 0) {
+			errno = -r;
+			die_errno(-1, "hashtable_create");
+		}
+	}
+
+	node = hashtable_find(data->fdmap, fd + 1, create);
+	if (!node && create)
+		die_errno(-1, "hashtable_find");
+	return node;
+}
+
+static void
+fdtable_forget(proc_data_t *data, long fd)
+{
+	ht_int64_node_t *node;
+
+	/* The key is kept, removing it would break the probe sequence */
+	if ((node = fdtable_node(data, fd, false)) && node->data) {
+		free_fd_info(node->data);
+		node->data = NULL;
+	}
+}
+
+/*
+ * Look up the path of the directory file descriptor.
+ * Returns 0 and stores the path in buf if the file descriptor is known,
+ * negated errno otherwise. The path is valid until the table of the process
+ * changes.
+ */
+int
+fdtable_lookup(proc_data_t *data, long fd, const char **buf)
+{
+	fd_info_t *info;
+	ht_int64_node_t *node;
+
+	if (data->fd_shared
+			|| !(node = fdtable_node(data, fd, false))
+			|| !(info = node->data))
+		goto miss;
+
+	if (info->remove_gen != pandora->remove_gen) {
+		fdtable_forget(data, fd);
+		goto miss;
+	}
+
+	++pandora->stats.fd_hit;
+	*buf = info->path;
+	return 0;
+miss:
+	++pandora->stats.fd_miss;
+	return -ENOENT;
+}
+
+/* Remember the path of the file descriptor, only directories are remembered */
+void
+fdtable_learn(pid_t pid, proc_data_t *data, long fd, const char *path)
+{
+	struct stat st;
+	fd_info_t *info;
+	ht_int64_node_t *node;
+
+	fdtable_forget(data, fd);
+
+	if (data->fd_shared || fdtable_stat(pid, fd, &st) < 0 || !S_ISDIR(st.st_mode))
+		return;
+
+	info = xmalloc(sizeof(fd_info_t));
+	info->path = xstrdup(path);
+	info->remove_gen = pandora->remove_gen;
+
+	node = fdtable_node(data, fd, true);
+	node->data = info;
+}
+
+/* Copy the entry of oldfd to newfd, which is closed first */
+void
+fdtable_dup(proc_data_t *data, long oldfd, long newfd)
+{
+	fd_info_t *info, *newinfo;
+	ht_int64_node_t *node;
+
+	if (oldfd == newfd)
+		return;
+
+	fdtable_forget(data, newfd);
+
+	if (!(node = fdtable_node(data, oldfd, false)) || !(info = node->data))
+		return;
+
+	newinfo = xmalloc(sizeof(fd_info_t));
+	memcpy(newinfo, info, sizeof(fd_info_t));
+	newinfo->path = xstrdup(info->path);
+
+	node = fdtable_node(data, newfd, true);
+	node->data = newinfo;
+}
+
+/* Forget the file descriptors from first to last, which are being closed */
+void
+fdtable_close(proc_data_t *data, unsigned long first, unsigned long last)
+{
+	ht_int64_node_t *node;
+
+	if (!data->fdmap)
+		return;
+
+	if (first == last) {
+		fdtable_forget(data, first);
+		return;
+	}
+
+	for (int i = 0; i < data->fdmap->size; i++) {
+		node = HT_NODE(data->fdmap, data->fdmap->nodes, i);
+		if (node->data && (unsigned long)(node->key - 1) >= first
+				&& (unsigned long)(node->key - 1) <= last) {
+			free_fd_info(node->data);
+			node->data = NULL;
+		}
+	}
+}
+
+void
+fdtable_free(proc_data_t *data)
+{
+	ht_int64_node_t *node;
+
+	if (!data->fdmap)
+		return;
+
+	for (int i = 0; i < data->fdmap->size; i++) {
+		node = HT_NODE(data->fdmap, data->fdmap->nodes, i);
+		free_fd_info(node->data);
+	}
+	hashtable_destroy(data->fdmap);
+	data->fdmap = NULL;
+}
+
+/*
+ * Record the directory opened by the last system call at its exit, under the
+ * path box_check_path() resolved at its entry.
+ */
+int
+fdtable_opendir(pink_easy_process_t *current)
+{
+	long ret;
+	pid_t pid = pink_easy_process_get_pid(current);
+	proc_data_t *data = pink_easy_process_get_userdata(current);
+
+	if (!pink_util_get_return(pid, &ret)) {
+		if (errno != ESRCH) {
+			warning("pink_util_get_return(%lu) failed (errno:%d %s)",
+					(unsigned long)pid,
+					errno, strerror(errno));
+			return panic(current);
+		}
+		return PINK_EASY_CFLAG_DROP;
+	}
+
+	if (ret >= 0)
+		fdtable_learn(pid, data, ret, data->opendir_path);
+	return 0;
+}
@@ -0,0 +1,207 @@
+/* vim: set cino= fo=croql sw=8 ts=8 sts=0 noet cin fdm=syntax : */
+
+/*
+ * Copyright (c) 2011 Ali Polatel <alip@exherbo.org>
+ *
+ * This file is part of Pandora's Box. pandora is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * pandora is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "pandora-defs.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hashtable.h"
+#include "util.h"
+
+/*
+ * Strings which are kept around for a long time are interned here: working
+ * directories, process names, resolved execve() paths, the paths of bound
+ * sockets and the patterns of the sandbox lists. Children start with the
+ * directory, name and lists of their parent and build scripts keep running
+ * the same programs in the same directories, so the same strings used to be
+ * copied over and over again. Interned strings are reference counted, a new
+ * process takes references instead of copying the strings of its parent.
+ *
+ * Equal strings are interned only once, so interned strings can be compared
+ * by pointer. Each string also gets an id, which isn't reused during the run
+ * as long as the string is alive, see intern_id().
+ *
+ * The table is keyed by a 64 bit hash of the string and colliding strings are
+ * chained. Entries are removed from the table when their last reference is
+ * released, which leaves their key behind, so the table is rebuilt when most
+ * of its keys are stale.
+ */
+#define INTERN_TABLE_MIN	64
+
+typedef struct intern_entry {
+	unsigned refs;
+	unsigned long id;
+	int64 key;
+	struct intern_entry *next;
+	char str[];
+} intern_entry_t;
+
+static hashtable_t *intern_table;
+static int intern_live;
+static unsigned long intern_lastid;
+
+static intern_entry_t *
+intern_entry(const char *str)
+{
+	return CONST_TO_PTR(str - offsetof(intern_entry_t, str));
+}
+
+static void
+intern_table_create(int size)
+{
+	int r;
+
+	if ((r = hashtable_create(size, 1, &intern_table)) < 0) {
+		errno = -r;
+		die_errno(-1, "hashtable_create");
+	}
+}
+
+/* Drop the keys of released entries */
+static void
+intern_table_rebuild(void)
+{
+	hashtable_t *old = intern_table;
+	ht_int64_node_t *node, *newnode;
+
+	intern_table_create(intern_live * 2);
+	for (int i = 0; i < old->size; i++) {
+		node = HT_NODE(old, old->nodes, i);
+		if (!node->data)
+			continue;
+		if (!(newnode = hashtable_find(intern_table, node->key, 1)))
+			die_errno(-1, "hashtable_find");
+		newnode->data = node->data;
+	}
+	hashtable_destroy(old);
+}
+
+/*
+ * Return the interned copy of the string with a new reference.
+ * Release it with intern_release().
+ */
+const char *
+intern(const char *str)
+{
+	size_t len;
+	int64 key;
+	intern_entry_t *entry;
+	ht_int64_node_t *node;
+
+	assert(str);
+
+	if (!intern_table)
+		intern_table_create(INTERN_TABLE_MIN);
+	else if (intern_table->entries > INTERN_TABLE_MIN && intern_table->entries > 2 * intern_live)
+		intern_table_rebuild();
+
+	key = hash_str(str);
+	if (!(node = hashtable_find(intern_table, key, 1)))
+		die_errno(-1, "hashtable_find");
+
+	for (entry = node->data; entry; entry = entry->next) {
+		if (streq(entry->str, str)) {
+			++entry->refs;
+			return entry->str;
+		}
+	}
+
+	len = strlen(str) + 1;
+	entry = xmalloc(sizeof(intern_entry_t) + len);
+	memcpy(entry->str, str, len);
+	entry->refs = 1;
+	entry->id = ++intern_lastid;
+	entry->key = key;
+	entry->next = node->data;
+	if (!node->data)
+		++intern_live;
+	node->data = entry;
+
+	return entry->str;
+}
+
+/* Take another reference of an interned string */
+const char *
+intern_ref(const char *str)
+{
+	assert(str);
+
+	++intern_entry(str)->refs;
+	return str;
+}
+
+/* Id of an interned string, zero for NULL */
+unsigned long
+intern_id(const char *str)
+{
+	if (!str)
+		return 0;
+	return ((const intern_entry_t *)(str - offsetof(intern_entry_t, str)))->id;
+}
+
+/* Drop a reference of an interned string, NULL is ignored */
+void
+intern_release(const char *str)
+{
+	intern_entry_t *entry, *prev;
+	ht_int64_node_t *node;
+
+	if (!str)
+		return;
+
+	entry = intern_entry(str);
+	assert(entry->refs > 0);
+	if (--entry->refs)
+		return;
+
+	if (intern_table && (node = hashtable_find(intern_table, entry->key, 0))) {
+		if (node->data == entry) {
+			node->data = entry->next;
+			if (!node->data)
+				--intern_live;
+		}
+		else if (node->data) {
+			for (prev = node->data; prev->next; prev = prev->next) {
+				if (prev->next == entry) {
+					prev->next = entry->next;
+					break;
+				}
+			}
+		}
+	}
+	free(entry);
+}
+
+/* Free the table, entries still referenced are kept until released */
+void
+intern_free(void)
+{
+	if (!intern_table)
+		return;
+
+	hashtable_destroy(intern_table);
+	intern_table = NULL;
+	intern_live = 0;
+}
@@ -175,14 +175,14 @@ static inline slist_t *_box_filter_sock(PINK_GCC_ATTR((unused)) pink_easy_proces
 		switch (op) {										\
 		case PANDORA_MAGIC_ADD_CHAR:								\
 			node = xcalloc(1, sizeof(struct snode));					\
-			node->data = xstrdup(str);							\
+			node->data = CONST_TO_PTR(intern(str));						\
 			SLIST_INSERT_HEAD(head, node, field);						\
 			return 0;									\
 		case PANDORA_MAGIC_REMOVE_CHAR:								\
 			SLIST_FOREACH(node, head, field) {						\
 				if (streq(node->data, str)) {						\
 					SLIST_REMOVE(head, node, snode, field);				\
-					free(node->data);						\
+					intern_release(node->data);					\
 					free(node);							\
 					break;								\
 				}									\
@@ -193,6 +193,17 @@ static inline slist_t *_box_filter_sock(PINK_GCC_ATTR((unused)) pink_easy_proces
 		}											\
 	}
 
+/* Update the filter of the pattern if the list is a path list of the sandbox */
+static void
+_path_filter_update(pink_easy_process_t *current, const slist_t *head, const char *pattern, int delta)
+{
+	int list;
+	sandbox_t *box = box_current(current);
+
+	if ((list = box_path_list_index(box, head)) >= 0)
+		verdict_filter_update(&box->filter[list], pattern, delta);
+}
+
 #define DEFINE_STRING_LIST_SETTING_FUNC(name, field)					\
 	static int _set_##name(const void *val, pink_easy_process_t *current)		\
 	{										\
@@ -212,14 +223,16 @@ static inline slist_t *_box_filter_sock(PINK_GCC_ATTR((unused)) pink_easy_proces
 		switch (op) {								\
 		case PANDORA_MAGIC_ADD_CHAR:						\
 			node = xcalloc(1, sizeof(struct snode));			\
-			node->data = xstrdup(str);					\
+			node->data = CONST_TO_PTR(intern(str));				\
 			SLIST_INSERT_HEAD(head, node, field);				\
+			_path_filter_update(current, head, str, 1);			\
 			return 0;							\
 		case PANDORA_MAGIC_REMOVE_CHAR:						\
 			SLIST_FOREACH(node, head, field) {				\
 				if (streq(node->data, str)) {				\
 					SLIST_REMOVE(head, node, snode, field);		\
-					free(node->data);				\
+					_path_filter_update(current, head, str, -1);	\
+					intern_release(node->data);			\
 					free(node);					\
 					break;						\
 				}							\
@@ -305,6 +318,7 @@ DEFINE_GLOBAL_BOOL_SETTING_FUNC(violation_raise_fail, pandora->config.violation_
 DEFINE_GLOBAL_BOOL_SETTING_FUNC(violation_raise_safe, pandora->config.violation_raise_safe)
 DEFINE_GLOBAL_BOOL_SETTING_FUNC(trace_follow_fork, pandora->config.follow_fork)
 DEFINE_GLOBAL_BOOL_SETTING_FUNC(trace_exit_wait_all, pandora->config.exit_wait_all)
+DEFINE_GLOBAL_BOOL_SETTING_FUNC(trace_use_openat2, pandora->config.use_openat2)
 DEFINE_SANDBOX_SETTING_FUNC(sandbox_exec)
 DEFINE_SANDBOX_SETTING_FUNC(sandbox_read)
 DEFINE_SANDBOX_SETTING_FUNC(sandbox_write)
@@ -355,6 +369,21 @@ _set_log_file(const void *val, PINK_GCC_ATTR((unused)) pink_easy_process_t *curr
 	return 0;
 }
 
+static int
+_set_log_stats_file(const void *val, PINK_GCC_ATTR((unused)) pink_easy_process_t *current)
+{
+	const char *str = val;
+
+	if (!str)
+		return MAGIC_ERROR_INVALID_VALUE;
+
+	if (pandora->config.stats_file)
+		free(pandora->config.stats_file);
+	pandora->config.stats_file = *str ? xstrdup(str) : NULL;
+
+	return 0;
+}
+
 static int
 _set_abort_decision(const void *val, PINK_GCC_ATTR((unused)) pink_easy_process_t *current)
 {
@@ -394,6 +423,42 @@ _set_violation_decision(const void *val, PINK_GCC_ATTR((unused)) pink_easy_proce
 	return 0;
 }
 
+static int
+_set_trace_use_seccomp(const void *val, PINK_GCC_ATTR((unused)) pink_easy_process_t *current)
+{
+#if PANDORA_HAVE_SECCOMP
+	pandora->config.use_seccomp = PTR_TO_BOOL(val);
+	return 0;
+#else
+	if (PTR_TO_BOOL(val))
+		return MAGIC_ERROR_NOT_SUPPORTED;
+	pandora->config.use_seccomp = false;
+	return 0;
+#endif
+}
+
+static int
+_query_trace_use_seccomp(PINK_GCC_ATTR((unused)) pink_easy_process_t *current)
+{
+	return pandora->config.use_seccomp;
+}
+
+static int
+_set_trace_track_fds(const void *val, PINK_GCC_ATTR((unused)) pink_easy_process_t *current)
+{
+	/* close() is only stopped for if this is set before tracing starts */
+	if (PTR_TO_BOOL(val) && !pandora->config.track_fds && pandora->ctx)
+		return MAGIC_ERROR_NOT_SUPPORTED;
+	pandora->config.track_fds = PTR_TO_BOOL(val);
+	return 0;
+}
+
+static int
+_query_trace_track_fds(PINK_GCC_ATTR((unused)) pink_easy_process_t *current)
+{
+	return pandora->config.track_fds;
+}
+
 static int
 _set_trace_magic_lock(const void *val, pink_easy_process_t *current)
 {
@@ -552,6 +617,14 @@ static const struct key key_table[] = {
 			.type   = MAGIC_TYPE_INTEGER,
 			.set    = _set_log_level,
 		},
+	[MAGIC_KEY_CORE_LOG_STATS_FILE] =
+		{
+			.name   = "stats_file",
+			.lname  = "core.log.stats_file",
+			.parent = MAGIC_KEY_CORE_LOG,
+			.type   = MAGIC_TYPE_STRING,
+			.set    = _set_log_stats_file,
+		},
 	[MAGIC_KEY_CORE_LOG_TIMESTAMP] =
 		{
 			.name   = "timestamp",
@@ -710,6 +783,33 @@ static const struct key key_table[] = {
 			.type   = MAGIC_TYPE_STRING,
 			.set    = _set_trace_magic_lock,
 		},
+	[MAGIC_KEY_CORE_TRACE_TRACK_FDS] =
+		{
+			.name   = "track_fds",
+			.lname  = "core.trace.track_fds",
+			.parent = MAGIC_KEY_CORE_TRACE,
+			.type   = MAGIC_TYPE_BOOLEAN,
+			.set    = _set_trace_track_fds,
+			.query  = _query_trace_track_fds,
+		},
+	[MAGIC_KEY_CORE_TRACE_USE_OPENAT2] =
+		{
+			.name   = "use_openat2",
+			.lname  = "core.trace.use_openat2",
+			.parent = MAGIC_KEY_CORE_TRACE,
+			.type   = MAGIC_TYPE_BOOLEAN,
+			.set    = _set_trace_use_openat2,
+			.query  = _query_trace_use_openat2,
+		},
+	[MAGIC_KEY_CORE_TRACE_USE_SECCOMP] =
+		{
+			.name   = "use_seccomp",
+			.lname  = "core.trace.use_seccomp",
+			.parent = MAGIC_KEY_CORE_TRACE,
+			.type   = MAGIC_TYPE_BOOLEAN,
+			.set    = _set_trace_use_seccomp,
+			.query  = _query_trace_use_seccomp,
+		},
 
 	[MAGIC_KEY_EXEC_KILL_IF_MATCH] =
 		{
@@ -870,6 +970,8 @@ magic_strerror(enum magic_error error)
 		return "No permission";
 	case MAGIC_ERROR_OOM:
 		return "Out of memory";
+	case MAGIC_ERROR_NOT_SUPPORTED:
+		return "Not supported";
 	default:
 		return "Unknown error";
 	}
@@ -918,7 +1020,10 @@ magic_key_lookup(enum magic_key key, const char *nkey, ssize_t len)
 int
 magic_cast(pink_easy_process_t *current, enum magic_key key, enum magic_type type, const void *val)
 {
+	int r;
+	enum path_list list;
 	struct key entry;
+	sandbox_t *box;
 
 	if (key >= MAGIC_KEY_INVALID)
 		return MAGIC_ERROR_INVALID_KEY;
@@ -936,7 +1041,38 @@ magic_cast(pink_easy_process_t *current, enum magic_key key, enum magic_type typ
 		} while (k != MAGIC_KEY_NONE);
 	}
 
-	return entry.set(val, current);
+	if ((r = entry.set(val, current)) < 0)
+		return r;
+
+	switch (key) {
+	case MAGIC_KEY_WHITELIST_EXEC:
+		list = PATH_LIST_WHITELIST_EXEC;
+		break;
+	case MAGIC_KEY_WHITELIST_READ:
+		list = PATH_LIST_WHITELIST_READ;
+		break;
+	case MAGIC_KEY_WHITELIST_WRITE:
+		list = PATH_LIST_WHITELIST_WRITE;
+		break;
+	case MAGIC_KEY_BLACKLIST_EXEC:
+		list = PATH_LIST_BLACKLIST_EXEC;
+		break;
+	case MAGIC_KEY_BLACKLIST_READ:
+		list = PATH_LIST_BLACKLIST_READ;
+		break;
+	case MAGIC_KEY_BLACKLIST_WRITE:
+		list = PATH_LIST_BLACKLIST_WRITE;
+		break;
+	default:
+		return r;
+	}
+
+	/* Invalidate the cached verdicts and the compiled set of the old list */
+	box = box_current(current);
+	verdict_rehash(box);
+	box_patset_stale(box, list);
+
+	return r;
 }
 
 static int
@@ -0,0 +1,245 @@
+/* vim: set cino= fo=croql sw=8 ts=8 sts=0 noet cin fdm=syntax : */
+
+/*
+ * Copyright (c) 2011 Ali Polatel <alip@exherbo.org>
+ *
+ * This file is part of Pandora's Box. pandora is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * pandora is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "pandora-defs.h"
+
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <pinktrace/pink.h>
+#include <pinktrace/easy/pink.h>
+
+/*
+ * Reading tracee memory with PTRACE_PEEKDATA costs a system call per word.
+ * process_vm_readv() reads any amount in a single call, but fails as a whole
+ * if any part of the remote range is unmapped. Reads are therefore split at
+ * page boundaries, so a string ending just before an unmapped page can still
+ * be read. When process_vm_readv() is not available (kernels older than 3.2),
+ * or not allowed for a process, we fall back to peeking, in small chunks so
+ * strings don't cost much more than they used to.
+ */
+#define MEM_PEEK_CHUNK	(8 * sizeof(long))
+
+static unsigned long page_size;
+#ifdef HAVE_PROCESS_VM_READV
+static bool vm_readv_broken;
+#endif
+
+static size_t
+mem_chunk(PINK_GCC_ATTR((unused)) const proc_data_t *data, long addr, size_t len)
+{
+	size_t max;
+
+	if (!page_size)
+		page_size = sysconf(_SC_PAGESIZE);
+
+	max = page_size - ((unsigned long)addr & (page_size - 1));
+#ifdef HAVE_PROCESS_VM_READV
+	if ((vm_readv_broken || data->vm_readv_eperm) && max > MEM_PEEK_CHUNK)
+		max = MEM_PEEK_CHUNK;
+#else
+	if (max > MEM_PEEK_CHUNK)
+		max = MEM_PEEK_CHUNK;
+#endif
+	return len < max ? len : max;
+}
+
+static bool
+mem_peek(pid_t pid, long addr, void *dest, size_t len)
+{
+	pandora->stats.mem_syscalls += (len + sizeof(long) - 1) / sizeof(long);
+	return pink_util_moven(pid, addr, dest, len);
+}
+
+static bool
+mem_read_chunked(pid_t pid, long addr, proc_data_t *data, void *dest, size_t len)
+{
+	size_t n;
+	char *d = dest;
+
+	while (len > 0) {
+		n = mem_chunk(data, addr, len);
+#ifdef HAVE_PROCESS_VM_READV
+		if (!vm_readv_broken && !data->vm_readv_eperm) {
+			ssize_t r;
+			struct iovec local, remote;
+
+			local.iov_base = d;
+			local.iov_len = n;
+			remote.iov_base = (void *)(uintptr_t)addr;
+			remote.iov_len = n;
+
+			++pandora->stats.mem_syscalls;
+			r = process_vm_readv(pid, &local, 1, &remote, 1, 0);
+			if (r < 0 && errno == ENOSYS) {
+				vm_readv_broken = true;
+				continue;
+			}
+			else if (r < 0 && errno == EPERM) {
+				/* Won't work any better for the next chunk */
+				data->vm_readv_eperm = true;
+				continue;
+			}
+			else if (r < 0)
+				return false;
+			else if ((size_t)r != n) {
+				errno = EFAULT;
+				return false;
+			}
+		}
+		else
+#endif /* HAVE_PROCESS_VM_READV */
+		if (!mem_peek(pid, addr, d, n))
+			return false;
+
+		d += n;
+		addr += n;
+		len -= n;
+	}
+
+	return true;
+}
+
+/*
+ * Read len bytes at addr from the memory of the given process.
+ * Returns false and sets errno on failure.
+ */
+bool
+mem_read(pid_t pid, long addr, proc_data_t *data, void *dest, size_t len)
+{
+	/* Keep track of how many peeks this would have cost */
+	pandora->stats.mem_peeks += (len + sizeof(long) - 1) / sizeof(long);
+
+	return mem_read_chunked(pid, addr, data, dest, len);
+}
+
+/*
+ * Read the NUL-terminated string at addr from the memory of the given process
+ * into the per-process buffer, which is reused between system calls.
+ * The result is valid until the next call for the same process.
+ * Returns false and sets errno on failure.
+ */
+bool
+mem_read_string(pid_t pid, long addr, proc_data_t *data, char **buf)
+{
+	char *nul;
+	size_t n, len;
+
+	++pandora->stats.mem_paths;
+
+	len = 0;
+	for (;;) {
+		n = mem_chunk(data, addr + len, SIZE_MAX);
+		if (data->membuf_size < len + n) {
+			data->membuf_size = len + n > PATH_MAX ? len + n : PATH_MAX;
+			data->membuf = xrealloc(data->membuf, data->membuf_size);
+		}
+
+		if (!mem_read_chunked(pid, addr + len, data, data->membuf + len, n))
+			return false;
+		if ((nul = memchr(data->membuf + len, '\0', n))) {
+			len = nul - data->membuf + 1;
+			break;
+		}
+		len += n;
+	}
+
+	pandora->stats.mem_peeks += (len + sizeof(long) - 1) / sizeof(long);
+
+	*buf = data->membuf;
+	return true;
+}
+
+/*
+ * Decode the path argument at the given index.
+ * Returns false and sets errno on failure, *buf is NULL for NULL arguments.
+ */
+bool
+mem_decode_string(pid_t pid, proc_data_t *data, unsigned ind, char **buf)
+{
+	if (!data->args[ind]) {
+		*buf = NULL;
+		return true;
+	}
+	return mem_read_string(pid, data->args[ind], data, buf);
+}
+
+/*
+ * Decode the socket address argument at the given index, and optionally the
+ * file descriptor argument, looking into the argument array for socketcall().
+ * The family of NULL addresses is set to -1.
+ * Returns false and sets errno on failure.
+ */
+bool
+mem_decode_socket_address(pid_t pid, pink_bitness_t bit, proc_data_t *data,
+		unsigned ind, long *fd_r, pink_socket_address_t *psa)
+{
+	unsigned i, wsize;
+	long addr, args[PINK_MAX_INDEX];
+	unsigned char raw[PINK_MAX_INDEX * sizeof(long)];
+	size_t len;
+
+	if (!data->subcall) {
+		for (i = 0; i <= ind + 1 && i < PINK_MAX_INDEX; i++)
+			args[i] = data->args[i];
+	}
+	else {
+		/* The arguments are an array of unsigned longs of the
+		 * personality pointed by the second argument. */
+		wsize = (bit == PINK_BITNESS_32) ? sizeof(uint32_t) : sizeof(long);
+		if (!mem_read(pid, data->args[1], data, raw, wsize * (ind + 2)))
+			return false;
+		for (i = 0; i < ind + 2; i++) {
+			if (wsize == sizeof(uint32_t)) {
+				uint32_t v;
+				memcpy(&v, raw + i * wsize, wsize);
+				args[i] = v;
+			}
+			else
+				memcpy(&args[i], raw + i * wsize, wsize);
+		}
+	}
+
+	if (fd_r)
+		*fd_r = args[0];
+
+	addr = args[ind];
+	len = (unsigned long)args[ind + 1];
+
+	memset(psa, 0, sizeof(pink_socket_address_t));
+	if (!addr) {
+		psa->family = -1;
+		return true;
+	}
+
+	if (len > sizeof(psa->u._pad))
+		len = sizeof(psa->u._pad);
+	if (!mem_read(pid, addr, data, psa->u._pad, len))
+		return false;
+
+	psa->family = psa->u.sa.sa_family;
+	psa->length = len;
+	return true;
+}
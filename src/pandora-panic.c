@@ -67,6 +67,7 @@ cont_one(pink_easy_process_t *proc, void *userdata)
 	else
 		fprintf(stderr, "resuming process:%lu\n", (unsigned long)pid);
 
+	pandora->untraced = true;
 	if (!pink_easy_process_resume(proc, 0) && errno != ESRCH) {
 		if (PTR_TO_UINT(userdata))
 			warning("failed to resume process:%lu (errno:%d %s)",
@@ -148,13 +149,17 @@ deny(pink_easy_process_t *current)
 	pid_t pid = pink_easy_process_get_pid(current);
 	pink_bitness_t bit = pink_easy_process_get_bitness(current);
 	proc_data_t *data = pink_easy_process_get_userdata(current);
+	sysstat_t *stat;
 
 	data->deny = true;
 	data->ret = errno2retval();
 
-	if (!pink_util_set_syscall(pid, bit, PINKTRACE_INVALID_SYSCALL)) {
+	if ((stat = systable_stat(data->sno, bit)))
+		++stat->denied;
+
+	if (!regs_set(pid, bit, data, PINKTRACE_INVALID_SYSCALL, false, 0)) {
 		if (errno != ESRCH) {
-			warning("pink_util_set_syscall(%d, \"%s\", 0xbadca11): %d(%s)",
+			warning("regs_set(%d, \"%s\", 0xbadca11): %d(%s)",
 					pid, pink_bitness_name(bit),
 					errno, strerror(errno));
 			return panic(current);
@@ -172,24 +177,38 @@ restore(pink_easy_process_t *current)
 	pink_bitness_t bit = pink_easy_process_get_bitness(current);
 	proc_data_t *data = pink_easy_process_get_userdata(current);
 
-	/* Restore system call number */
-	if (!pink_util_set_syscall(pid, bit, data->sno)) {
+	/* Restore system call number and return the saved return value */
+	if (!regs_set(pid, bit, data, data->sno, true, data->ret)) {
 		if (errno == ESRCH)
 			return PINK_EASY_CFLAG_DROP;
-		warning("pink_util_set_syscall(%lu, %s, %s): errno:%d (%s)",
+		warning("regs_set(%lu, %s, %s): errno:%d (%s)",
 				(unsigned long)pid, pink_bitness_name(bit),
 				pink_name_syscall(data->sno, bit),
 				errno, strerror(errno));
 	}
 
-	/* Return the saved return value */
-	if (!pink_util_set_return(pid, data->ret)) {
+	return 0;
+}
+
+/*
+ * Skip a denied system call at a seccomp stop.
+ * The kernel doesn't run a system call whose number is -1 and leaves the
+ * return value as we set it so there is no need to stop at system call exit.
+ */
+int
+skip(pink_easy_process_t *current)
+{
+	pid_t pid = pink_easy_process_get_pid(current);
+	pink_bitness_t bit = pink_easy_process_get_bitness(current);
+	proc_data_t *data = pink_easy_process_get_userdata(current);
+
+	if (!regs_set(pid, bit, data, -1, true, data->ret)) {
 		if (errno == ESRCH)
 			return PINK_EASY_CFLAG_DROP;
-		warning("pink_util_set_return(%lu, %s, %s): errno:%d (%s)",
+		warning("regs_set(%lu, %s, -1): errno:%d (%s)",
 				(unsigned long)pid, pink_bitness_name(bit),
-				pink_name_syscall(data->sno, bit),
 				errno, strerror(errno));
+		return panic(current);
 	}
 
 	return 0;
@@ -22,6 +22,9 @@
 #include <assert.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include <pinktrace/pink.h>
 #include <pinktrace/easy/pink.h>
@@ -29,6 +32,7 @@
 #include "proc.h"
 
 /* Decode the path at the given index and place it in buf.
+ * The path lives in the per-process decode buffer, don't free it.
  * Handles panic() itself.
  * Returns:
  * -1 : System call must be denied.
@@ -46,16 +50,14 @@ path_decode(pink_easy_process_t *current, unsigned ind, char **buf)
 	assert(current);
 	assert(buf);
 
-	errno = 0;
-	path = pink_decode_string_persistent(pid, bit, ind);
-	if (errno) {
+	if (!mem_decode_string(pid, data, ind, &path)) {
 		if (errno != ESRCH) {
-			warning("pink_decode_string_persistent(%lu, %s, %u) failed (errno:%d %s)",
+			warning("mem_decode_string(%lu, %s, %u) failed (errno:%d %s)",
 					(unsigned long)pid, pink_bitness_name(bit),
 					ind, errno, strerror(errno));
 			return panic(current);
 		}
-		debug("pink_decode_string_persistent(%lu, %s, %u) failed (errno:%d %s)",
+		debug("mem_decode_string(%lu, %s, %u) failed (errno:%d %s)",
 				(unsigned long)pid, pink_bitness_name(bit),
 				ind, errno, strerror(errno));
 		debug("dropping process:%lu [%s name:\"%s\" cwd:\"%s\"] from process tree",
@@ -64,7 +66,7 @@ path_decode(pink_easy_process_t *current, unsigned ind, char **buf)
 		return PINK_EASY_CFLAG_DROP;
 	}
 	else if (!path) {
-		debug("pink_decode_string_persistent(%lu, %s, %u) returned NULL",
+		debug("mem_decode_string(%lu, %s, %u) returned NULL",
 				(unsigned long)pid, pink_bitness_name(bit), ind);
 		*buf = NULL;
 		errno = EFAULT;
@@ -75,8 +77,12 @@ path_decode(pink_easy_process_t *current, unsigned ind, char **buf)
 	return 0;
 }
 
+/* Prefixes read from /proc, see path_prefix() */
+static char path_prefixbuf[PATH_MAX];
+
 /*
  * Resolve the prefix of an at-suffixed function.
+ * The prefix is valid until the next call.
  * Handles panic() itself.
  * Returns:
  * -1 : System call must be denied.
@@ -84,32 +90,25 @@ path_decode(pink_easy_process_t *current, unsigned ind, char **buf)
  * >0 : PINK_EASY_CFLAG* flags
  */
 int
-path_prefix(pink_easy_process_t *current, unsigned ind, char **buf)
+path_prefix(pink_easy_process_t *current, unsigned ind, const char **buf)
 {
 	int r;
 	long fd;
+	size_t len;
 	char *prefix;
+	const char *known;
 	pid_t pid = pink_easy_process_get_pid(current);
-	pink_bitness_t bit = pink_easy_process_get_bitness(current);
 	proc_data_t *data = pink_easy_process_get_userdata(current);
 
-	if (!pink_util_get_arg(pid, bit, ind, &fd)) {
-		if (errno != ESRCH) {
-			warning("pink_util_get_arg(%lu, \"%s\", %u) failed (errno:%d %s)",
-					(unsigned long)pid, pink_bitness_name(bit),
-					ind, errno, strerror(errno));
-			return panic(current);
-		}
-		debug("pink_util_get_arg(%lu, \"%s\", %u) failed (errno:%d %s)",
-				(unsigned long)pid, pink_bitness_name(bit),
-				ind, errno, strerror(errno));
-		debug("dropping process:%lu [%s name:\"%s\" cwd:\"%s\"] from process tree",
-				(unsigned long)pid, pink_bitness_name(bit),
-				data->comm, data->cwd);
-		return PINK_EASY_CFLAG_DROP;
-	}
+	/* Arguments of the 32 bit personality are zero extended */
+	fd = (int)data->args[ind];
 
 	if (fd != AT_FDCWD) {
+		if (pandora->config.track_fds
+				&& !fdtable_lookup(data, fd, &known)) {
+			*buf = known;
+			return 0;
+		}
 		if ((r = proc_fd(pid, fd, &prefix)) < 0) {
 			warning("proc_fd(%lu, %ld) failed (errno:%d %s)",
 					(unsigned long)pid, fd,
@@ -117,7 +116,15 @@ path_prefix(pink_easy_process_t *current, unsigned ind, char **buf)
 			errno = r == -ENOENT ? EBADF : -r;
 			return -1;
 		}
-		*buf = prefix;
+		if (pandora->config.track_fds)
+			fdtable_learn(pid, data, fd, prefix);
+		if ((len = strlen(prefix) + 1) > sizeof(path_prefixbuf)) {
+			free(prefix);
+			errno = ENAMETOOLONG;
+			return -1;
+		}
+		*buf = memcpy(path_prefixbuf, prefix, len);
+		free(prefix);
 	}
 	else
 		*buf = NULL;
@@ -0,0 +1,767 @@
+/* vim: set cino= fo=croql sw=8 ts=8 sts=0 noet cin fdm=syntax : */
+
+/*
+ * Copyright (c) 2011 Ali Polatel <alip@exherbo.org>
+ *
+ * This file is part of Pandora's Box. pandora is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * pandora is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "pandora-defs.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util.h"
+#include "wildmatch.h"
+
+/*
+ * A list of patterns is compiled into a pattern set, which tells whether any
+ * of the patterns matches a path, and which one, in a single pass over the
+ * path. The semantics are those of wildmatch_ext().
+ *
+ * Patterns of the common shapes, a literal prefix followed by `**', or by a
+ * slash and `***', are kept in a radix trie of their prefixes, which is
+ * walked along the path. The other patterns are compiled into an automaton
+ * over path bytes: a pattern is a sequence of states, each matching a byte out
+ * of a set. The states of `*' and `**' loop and may be skipped. The states of
+ * all patterns are simulated together; most of them die at the first
+ * mismatching byte so few are ever active.
+ *
+ * The automaton is made deterministic lazily: a DFA state stands for a set of
+ * automaton states, and its transitions are computed the first time they are
+ * taken, then looked up in its table. Reaching the node of a prefix adds the
+ * states of its patterns, these transitions are kept in a list per DFA state.
+ * DFA states take memory, PATSET_DFA_MAX bytes at most per set. When a match
+ * would need more, the DFA is dropped and the path is matched with
+ * wildmatch_ext() against each pattern instead.
+ *
+ * Patterns under /proc are left out, see pandora-verdict.c, so paths under
+ * /proc must be matched with box_match_path() instead.
+ *
+ * Sets are immutable once compiled and shared between sandboxes by reference
+ * counting, see box_patset().
+ */
+
+typedef struct patnode {
+	/* Label of the edge from the parent, points into a pattern */
+	const char *label;
+	size_t len;
+
+	/* Pattern equal to the prefix, -1 if none */
+	int exact;
+	/* Pattern matching everything starting with the prefix, -1 if none */
+	int below;
+	/* Pattern matching the prefix and everything under it, -1 if none */
+	int dir;
+
+	/* Start states of the patterns with wildcards after the prefix */
+	unsigned nseed;
+	unsigned *seed;
+
+	/* Children sorted by the first byte of their labels */
+	unsigned nchild;
+	struct patnode **child;
+} patnode_t;
+
+#ifndef PATSET_DFA_MAX
+#define PATSET_DFA_MAX	(4UL << 20)
+#endif
+#define PATSET_DFA_BUCKETS	1024
+
+typedef struct patinject {
+	const struct patnode *node;
+	unsigned to;
+	struct patinject *next;
+} patinject_t;
+
+typedef struct {
+	/* Automaton states, sorted */
+	unsigned count;
+	unsigned *states;
+	unsigned hash;
+
+	/* Lowest pattern matching if the path ends here, -1 if none */
+	int final;
+	/* Lowest pattern matching whatever follows, -1 if none */
+	int sure;
+
+	/* Index + 1 of the state after each byte, zero if not known yet */
+	unsigned next[256];
+	/* States after reaching nodes with patterns to start */
+	patinject_t *inject;
+
+	/* Index + 1 of the next state in the bucket */
+	unsigned chain;
+} patdfa_t;
+
+typedef struct {
+	/* Bytes matched by this state */
+	uint32_t set[8];
+	/* Whether the state matches any number of bytes, `*' and `**' */
+	bool loop;
+	/* Whether this is the accepting state of the pattern */
+	bool final;
+	/* Whether reaching this state means the pattern matches, trailing `**' */
+	bool sure;
+	int pattern;
+} patstate_t;
+
+struct patset {
+	unsigned refs;
+
+	/* Interned patterns, in the order of the list */
+	unsigned count;
+	const char **patterns;
+
+	patnode_t *root;
+
+	unsigned nstates;
+	patstate_t *states;
+
+	/* Lazily built DFA, the first state is the empty set */
+	unsigned ndfa;
+	patdfa_t **dfa;
+	unsigned *bucket;
+	size_t dfa_size;
+};
+
+/* List of automaton states, shared by all sets since the tracer is single threaded */
+static struct {
+	unsigned size;
+	unsigned *cur;
+	unsigned long *mark;
+	unsigned long stamp;
+} scratch;
+
+#define SET_HAS(set, c)		((set)[(c) >> 5] & (1U << ((c) & 31)))
+#define SET_ADD(set, c)		((set)[(c) >> 5] |= (1U << ((c) & 31)))
+
+static patnode_t *
+patnode_new(const char *label, size_t len)
+{
+	patnode_t *node;
+
+	node = xcalloc(1, sizeof(patnode_t));
+	node->label = label;
+	node->len = len;
+	node->exact = node->below = node->dir = -1;
+	return node;
+}
+
+static void
+patnode_free(patnode_t *node)
+{
+	for (unsigned i = 0; i < node->nchild; i++)
+		patnode_free(node->child[i]);
+	free(node->child);
+	free(node->seed);
+	free(node);
+}
+
+/* Child whose label starts with the given byte, or the position to insert it */
+static unsigned
+patnode_find(const patnode_t *node, unsigned char c, bool *found)
+{
+	unsigned lo, hi, mid;
+
+	lo = 0;
+	hi = node->nchild;
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if ((unsigned char)node->child[mid]->label[0] < c)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	*found = lo < node->nchild && (unsigned char)node->child[lo]->label[0] == c;
+	return lo;
+}
+
+/* Insert the prefix, splitting edges as necessary, and return its node */
+static patnode_t *
+patnode_insert(patnode_t *root, const char *prefix, size_t len)
+{
+	bool found;
+	size_t k;
+	unsigned i;
+	patnode_t *node, *child, *mid;
+
+	node = root;
+	while (len > 0) {
+		i = patnode_find(node, prefix[0], &found);
+		if (!found) {
+			child = patnode_new(prefix, len);
+			node->child = xrealloc(node->child, (node->nchild + 1) * sizeof(patnode_t *));
+			memmove(node->child + i + 1, node->child + i, (node->nchild - i) * sizeof(patnode_t *));
+			node->child[i] = child;
+			node->nchild++;
+			return child;
+		}
+
+		child = node->child[i];
+		for (k = 1; k < child->len && k < len && child->label[k] == prefix[k]; k++)
+			;
+		if (k < child->len) {
+			mid = patnode_new(child->label, k);
+			mid->child = xmalloc(sizeof(patnode_t *));
+			mid->child[0] = child;
+			mid->nchild = 1;
+			child->label += k;
+			child->len -= k;
+			node->child[i] = mid;
+			child = mid;
+		}
+		prefix += k;
+		len -= k;
+		node = child;
+	}
+	return node;
+}
+
+static void
+patset_candidate(int *best, int pattern)
+{
+	if (pattern >= 0 && (*best < 0 || pattern < *best))
+		*best = pattern;
+}
+
+/* Length of the literal prefix of the pattern */
+static size_t
+pattern_literal(const char *pattern, size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		if (strchr("*?[\\", pattern[i]))
+			break;
+	}
+	return i;
+}
+
+/*
+ * End of the character class starting at pattern, following dowild(), NULL
+ * if it isn't terminated.
+ */
+static const char *
+pattern_class_end(const char *p)
+{
+	const char *s;
+	char c, prev;
+
+	if (*++p == '!' || *p == '^')
+		++p;
+	prev = 0;
+	c = *p;
+	do {
+		if (!c)
+			return NULL;
+		if (c == '\\') {
+			if (!(c = *++p))
+				return NULL;
+		}
+		else if (c == '-' && prev && p[1] && p[1] != ']') {
+			if ((c = *++p) == '\\' && !*++p)
+				return NULL;
+			c = 0;
+		}
+		else if (c == '[' && p[1] == ':') {
+			for (s = p += 2; (c = *p) && c != ']'; p++)
+				;
+			if (!c)
+				return NULL;
+			if (p - s - 1 < 0 || p[-1] != ':') {
+				p = s - 2;
+				c = '[';
+				continue;
+			}
+			c = 0;
+		}
+	} while (prev = c, (c = *++p) != ']');
+
+	return p;
+}
+
+static patstate_t *
+patset_state(patset_t *set, int pattern)
+{
+	patstate_t *st;
+
+	set->states = xrealloc(set->states, (set->nstates + 1) * sizeof(patstate_t));
+	st = &set->states[set->nstates++];
+	memset(st, 0, sizeof(patstate_t));
+	st->pattern = pattern;
+	return st;
+}
+
+/*
+ * Compile the pattern into states of the automaton and return the first one.
+ * Patterns which never match, like those with a trailing backslash or an
+ * unterminated character class, compile to nothing and -1 is returned.
+ */
+static int
+patset_compile_states(patset_t *set, int pattern, const char *p)
+{
+	bool special;
+	unsigned c, first;
+	char class[2], *cp;
+	const char *end;
+	patstate_t *st;
+
+	first = set->nstates;
+	for (; *p; p++) {
+		st = patset_state(set, pattern);
+		switch (*p) {
+		case '\\':
+			if (!*++p)
+				goto never;
+			/* fall through */
+		default:
+			SET_ADD(st->set, (unsigned char)*p);
+			break;
+		case '?':
+			for (c = 1; c < 256; c++)
+				SET_ADD(st->set, c);
+			st->set['/' >> 5] &= ~(1U << ('/' & 31));
+			break;
+		case '*':
+			special = p[1] == '*';
+			while (p[1] == '*')
+				p++;
+			st->loop = true;
+			for (c = 1; c < 256; c++)
+				SET_ADD(st->set, c);
+			if (!special)
+				st->set['/' >> 5] &= ~(1U << ('/' & 31));
+			st->sure = special && !p[1];
+			break;
+		case '[':
+			if (!(end = pattern_class_end(p)))
+				goto never;
+			/* Let wildmatch() decide which bytes the class matches */
+			cp = xstrndup(p, end - p + 1);
+			class[1] = '\0';
+			for (c = 1; c < 256; c++) {
+				class[0] = (char)c;
+				if (wildmatch(cp, class))
+					SET_ADD(st->set, c);
+			}
+			free(cp);
+			p = end;
+			break;
+		}
+	}
+	st = patset_state(set, pattern);
+	st->final = true;
+	return first;
+never:
+	set->nstates = first;
+	return -1;
+}
+
+/* Add the first len bytes of the pattern */
+static void
+patset_add_prefix(patset_t *set, int pattern, const char *p, size_t len)
+{
+	int first;
+	size_t k, lit;
+	char *rest;
+	patnode_t *node;
+
+	lit = pattern_literal(p, len);
+	node = patnode_insert(set->root, p, lit);
+	if (lit == len) {
+		patset_candidate(&node->exact, pattern);
+		return;
+	}
+
+	for (k = lit; k < len && p[k] == '*'; k++)
+		;
+	if (k == len && len - lit >= 2) {
+		patset_candidate(&node->below, pattern);
+		return;
+	}
+
+	/* Only what follows the prefix needs the automaton, started when the
+	 * walk along the path reaches the node of the prefix. */
+	rest = xstrndup(p + lit, len - lit);
+	if ((first = patset_compile_states(set, pattern, rest)) >= 0) {
+		node->seed = xrealloc(node->seed, (node->nseed + 1) * sizeof(unsigned));
+		node->seed[node->nseed++] = first;
+	}
+	free(rest);
+}
+
+static void
+patset_add(patset_t *set, int pattern, const char *p)
+{
+	size_t i;
+
+	if (!endswith(p, "/***")) {
+		patset_add_prefix(set, pattern, p, strlen(p));
+		return;
+	}
+
+	i = strrchr(p, '/') - p;
+	if (pattern_literal(p, i) == i) {
+		patset_candidate(&patnode_insert(set->root, p, i)->dir, pattern);
+		return;
+	}
+	/* The bare directory, and the pattern with one star less */
+	patset_add_prefix(set, pattern, p, i);
+	patset_add_prefix(set, pattern, p, i + 3);
+}
+
+/*
+ * Compile the list of patterns into a pattern set.
+ * Returns NULL if there is nothing to match.
+ */
+patset_t *
+patset_compile(const slist_t *patterns)
+{
+	unsigned count;
+	struct snode *node;
+	patset_t *set;
+
+	count = 0;
+	SLIST_FOREACH(node, patterns, up) {
+		if (!startswith(node->data, "/proc/"))
+			count++;
+	}
+	if (!count)
+		return NULL;
+
+	set = xcalloc(1, sizeof(patset_t));
+	set->refs = 1;
+	set->patterns = xmalloc(count * sizeof(char *));
+	set->root = patnode_new("", 0);
+
+	SLIST_FOREACH(node, patterns, up) {
+		if (startswith(node->data, "/proc/"))
+			continue;
+		set->patterns[set->count] = intern_ref(node->data);
+		patset_add(set, set->count, set->patterns[set->count]);
+		set->count++;
+	}
+
+	return set;
+}
+
+static void
+patset_dfa_flush(patset_t *set)
+{
+	patinject_t *inj, *next;
+
+	for (unsigned i = 0; i < set->ndfa; i++) {
+		for (inj = set->dfa[i]->inject; inj; inj = next) {
+			next = inj->next;
+			free(inj);
+		}
+		free(set->dfa[i]->states);
+		free(set->dfa[i]);
+	}
+	free(set->dfa);
+	free(set->bucket);
+	set->ndfa = 0;
+	set->dfa = NULL;
+	set->bucket = NULL;
+	set->dfa_size = 0;
+}
+
+patset_t *
+patset_ref(patset_t *set)
+{
+	if (set)
+		++set->refs;
+	return set;
+}
+
+void
+patset_release(patset_t *set)
+{
+	if (!set || --set->refs)
+		return;
+
+	for (unsigned i = 0; i < set->count; i++)
+		intern_release(set->patterns[i]);
+	free(set->patterns);
+	patnode_free(set->root);
+	free(set->states);
+	patset_dfa_flush(set);
+	free(set);
+}
+
+void
+patset_free(void)
+{
+	free(scratch.cur);
+	free(scratch.mark);
+	memset(&scratch, 0, sizeof(scratch));
+}
+
+/* Add the state and the states following the loops which may be skipped */
+static void
+patset_activate(const patset_t *set, unsigned s, unsigned *n)
+{
+	const patstate_t *st;
+
+	for (;;) {
+		if (scratch.mark[s] == scratch.stamp)
+			return;
+		scratch.mark[s] = scratch.stamp;
+		scratch.cur[(*n)++] = s;
+
+		st = &set->states[s];
+		if (st->final || !st->loop)
+			return;
+		s++;
+	}
+}
+
+static int
+patset_cmp(const void *a, const void *b)
+{
+	unsigned x = *(const unsigned *)a, y = *(const unsigned *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/*
+ * DFA state for the n automaton states in the scratch list, added if it's
+ * new. Returns -1 if adding it would take more memory than allowed.
+ */
+static int
+patset_dfa_lookup(patset_t *set, unsigned n)
+{
+	unsigned h, i;
+	size_t size;
+	const patstate_t *st;
+	patdfa_t *d;
+
+	if (n > 1)
+		qsort(scratch.cur, n, sizeof(unsigned), patset_cmp);
+	h = n;
+	for (i = 0; i < n; i++)
+		h = h * 31 + scratch.cur[i];
+
+	if (set->bucket) {
+		for (i = set->bucket[h % PATSET_DFA_BUCKETS]; i; i = set->dfa[i - 1]->chain) {
+			d = set->dfa[i - 1];
+			if (d->hash == h && d->count == n &&
+					(!n || !memcmp(d->states, scratch.cur, n * sizeof(unsigned))))
+				return i - 1;
+		}
+	}
+
+	size = sizeof(patdfa_t) + sizeof(patdfa_t *) + n * sizeof(unsigned);
+	if (set->dfa_size + size > PATSET_DFA_MAX)
+		return -1;
+	if (!set->bucket)
+		set->bucket = xcalloc(PATSET_DFA_BUCKETS, sizeof(unsigned));
+	set->dfa_size += size;
+	++pandora->stats.patset_dfa_states;
+
+	d = xcalloc(1, sizeof(patdfa_t));
+	d->count = n;
+	if (n) {
+		d->states = xmalloc(n * sizeof(unsigned));
+		memcpy(d->states, scratch.cur, n * sizeof(unsigned));
+	}
+	d->hash = h;
+	d->final = d->sure = -1;
+	for (i = 0; i < n; i++) {
+		st = &set->states[scratch.cur[i]];
+		if (st->final)
+			patset_candidate(&d->final, st->pattern);
+		if (st->sure)
+			patset_candidate(&d->sure, st->pattern);
+	}
+	d->chain = set->bucket[h % PATSET_DFA_BUCKETS];
+
+	set->dfa = xrealloc(set->dfa, (set->ndfa + 1) * sizeof(patdfa_t *));
+	set->dfa[set->ndfa++] = d;
+	set->bucket[h % PATSET_DFA_BUCKETS] = set->ndfa;
+	return set->ndfa - 1;
+}
+
+/* DFA state after the byte, -1 if it can't be added */
+static int
+patset_dfa_step(patset_t *set, unsigned from, unsigned char c)
+{
+	int to;
+	unsigned s, n;
+	const patdfa_t *d = set->dfa[from];
+	const patstate_t *st;
+
+	n = 0;
+	++scratch.stamp;
+	for (unsigned i = 0; i < d->count; i++) {
+		s = d->states[i];
+		st = &set->states[s];
+		if (!st->final && SET_HAS(st->set, c))
+			patset_activate(set, st->loop ? s : s + 1, &n);
+	}
+
+	if ((to = patset_dfa_lookup(set, n)) >= 0)
+		set->dfa[from]->next[c] = to + 1;
+	return to;
+}
+
+/* DFA state after reaching the node, -1 if it can't be added */
+static int
+patset_dfa_inject(patset_t *set, unsigned from, const patnode_t *node)
+{
+	int to;
+	unsigned n;
+	patinject_t *inj;
+	const patdfa_t *d = set->dfa[from];
+
+	for (inj = d->inject; inj; inj = inj->next) {
+		if (inj->node == node)
+			return inj->to;
+	}
+
+	n = 0;
+	++scratch.stamp;
+	for (unsigned i = 0; i < d->count; i++)
+		patset_activate(set, d->states[i], &n);
+	for (unsigned i = 0; i < node->nseed; i++)
+		patset_activate(set, node->seed[i], &n);
+
+	if ((to = patset_dfa_lookup(set, n)) < 0)
+		return -1;
+	if (set->dfa_size + sizeof(patinject_t) > PATSET_DFA_MAX)
+		return -1;
+	set->dfa_size += sizeof(patinject_t);
+
+	inj = xmalloc(sizeof(patinject_t));
+	inj->node = node;
+	inj->to = to;
+	inj->next = set->dfa[from]->inject;
+	set->dfa[from]->inject = inj;
+	return to;
+}
+
+/*
+ * Walk the trie along the path, running the DFA on the path bytes too.
+ * Returns -1 if the DFA grew too large.
+ */
+static int
+patset_scan(patset_t *set, const char *path, bool first, int *best)
+{
+	bool found;
+	int d;
+	unsigned i, n;
+	size_t off;
+	unsigned char c;
+	const unsigned char *t;
+	const patnode_t *node;
+
+	if (scratch.size < set->nstates) {
+		scratch.size = set->nstates;
+		scratch.cur = xrealloc(scratch.cur, scratch.size * sizeof(unsigned));
+		free(scratch.mark);
+		scratch.mark = xcalloc(scratch.size, sizeof(unsigned long));
+		scratch.stamp = 0;
+	}
+
+	/* Start with the empty set */
+	d = 0;
+	if (!set->ndfa && patset_dfa_lookup(set, 0) < 0)
+		return -1;
+
+	node = set->root;
+	off = 0;
+	for (t = (const unsigned char *)path;; t++) {
+		c = *t;
+		if (node && off == node->len) {
+			patset_candidate(best, node->below);
+			if (c == '\0' || c == '/')
+				patset_candidate(best, node->dir);
+			if (c == '\0')
+				patset_candidate(best, node->exact);
+			if (node->nseed && (d = patset_dfa_inject(set, d, node)) < 0)
+				return -1;
+		}
+		patset_candidate(best, set->dfa[d]->sure);
+
+		if (c == '\0' || (!first && *best >= 0))
+			break;
+
+		if (node && off < node->len) {
+			if (node->label[off] != (char)c)
+				node = NULL;
+		}
+		else if (node) {
+			i = patnode_find(node, c, &found);
+			node = found ? node->child[i] : NULL;
+			off = 0;
+		}
+		++off;
+		if (!node && !set->dfa[d]->count)
+			break;
+
+		if ((n = set->dfa[d]->next[c]))
+			d = n - 1;
+		else if ((d = patset_dfa_step(set, d, c)) < 0)
+			return -1;
+	}
+
+	if (c == '\0')
+		patset_candidate(best, set->dfa[d]->final);
+	return 0;
+}
+
+/* Match the path against each pattern, like box_match_path() */
+static int
+patset_fallback(const patset_t *set, const char *path)
+{
+	for (unsigned i = 0; i < set->count; i++) {
+		if (wildmatch_ext(set->patterns[i], path))
+			return i;
+	}
+	return -1;
+}
+
+/*
+ * Match the path, which must not be under /proc, against the pattern set.
+ * If match isn't NULL, it is set to the first matching pattern in the order
+ * of the list the set was compiled from.
+ * Returns nonzero if the path matches.
+ */
+int
+patset_match(patset_t *set, const char *path, const char **match)
+{
+	int best;
+	unsigned long long start;
+
+	if (!set)
+		return 0;
+
+	best = -1;
+	start = stats_now();
+	if (patset_scan(set, path, match != NULL, &best) < 0) {
+		++pandora->stats.patset_fallback;
+		patset_dfa_flush(set);
+		best = patset_fallback(set, path);
+	}
+	histogram_add(&pandora->stats.match, start);
+
+	if (best < 0)
+		return 0;
+	if (match)
+		*match = set->patterns[best];
+	return 1;
+}
@@ -0,0 +1,194 @@
+/* vim: set cino= fo=croql sw=8 ts=8 sts=0 noet cin fdm=syntax : */
+
+/*
+ * Copyright (c) 2011 Ali Polatel <alip@exherbo.org>
+ *
+ * This file is part of Pandora's Box. pandora is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * pandora is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "pandora-defs.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hashtable.h"
+#include "util.h"
+
+/*
+ * Most path arguments are already canonical: absolute, without `.', `..' or
+ * repeated slashes, under directories which aren't symbolic links. Resolving
+ * such a path doesn't change it, yet costs a lookup of every component.
+ *
+ * The directories whose path is known to be free of symbolic links are kept
+ * in a table shared by all processes. They are learned from paths which
+ * resolve to themselves. A path whose parent is in the table is resolved with
+ * a single lookup of its last component, which is only needed to tell whether
+ * it's a symbolic link or whether it exists. Entries are valid until a traced
+ * process removes or renames a file or changes the mounts, like the entries
+ * of existing components in the component cache, see pandora-dcache.c. As
+ * changes made by untraced processes aren't seen, they also expire at least
+ * once a second, see pandora-resolve.c. Directories under /proc are never
+ * kept.
+ *
+ * The table is a cache keyed by a hash of the path, see hashtable.h.
+ */
+#define PREFIX_MAX	16384
+
+typedef struct {
+	char *path;
+	unsigned long remove_gen;
+} prefix_t;
+
+static hashtable_t *prefixes;
+
+static void
+prefix_free_entry(void *data)
+{
+	prefix_t *entry = data;
+
+	free(entry->path);
+	free(entry);
+}
+
+/*
+ * Returns the length of the parent directory of the path if the path is
+ * absolute, has no empty, `.' or `..' components and doesn't end with a
+ * slash, zero otherwise. The parent of top level names is the root
+ * directory, whose length is one.
+ */
+static size_t
+prefix_parent(const char *path)
+{
+	const char *p, *last;
+
+	if (path[0] != '/' || !path[1])
+		return 0;
+	if (startswith(path, "/proc") && (path[5] == '/' || path[5] == '\0'))
+		return 0;
+
+	last = path;
+	for (p = path; *p; p++) {
+		if (*p != '/')
+			continue;
+		/* Empty component */
+		if (p[1] == '/' || p[1] == '\0')
+			return 0;
+		/* `.' or `..' component */
+		if (p[1] == '.' && (p[2] == '/' || p[2] == '\0'
+					|| (p[2] == '.' && (p[3] == '/' || p[3] == '\0'))))
+			return 0;
+		last = p;
+	}
+
+	return last == path ? 1 : (size_t)(last - path);
+}
+
+static bool
+prefix_known(const char *path, size_t len)
+{
+	prefix_t *entry;
+	ht_int64_node_t *node;
+
+	/* The root directory is never a symbolic link */
+	if (len == 1)
+		return true;
+	if (!prefixes)
+		return false;
+
+	if (!(node = hashtable_find(prefixes, hash_strn(path, len), 0))
+			|| !(entry = node->data))
+		return false;
+
+	return entry->remove_gen == pandora->remove_gen
+		&& !strncmp(entry->path, path, len)
+		&& entry->path[len] == '\0';
+}
+
+/*
+ * Try to resolve the absolute path without walking it.
+ * Returns true if the path resolves to itself or fails to resolve, storing
+ * zero or negated errno in ret and the type of the file in ftype, zero if it
+ * doesn't exist, false if it has to be resolved.
+ */
+bool
+prefix_resolve(const char *path, int maycreat, int resolve, int *ret, mode_t *ftype)
+{
+	size_t len;
+	struct stat st;
+
+	if (!(len = prefix_parent(path)) || !prefix_known(path, len))
+		return false;
+
+	if (dcache_lstat(path, &st) < 0) {
+		if (!maycreat) {
+			*ret = -errno;
+			return true;
+		}
+		st.st_mode = 0;
+	}
+	else if (resolve && S_ISLNK(st.st_mode))
+		return false;
+
+	*ftype = st.st_mode & S_IFMT;
+	++pandora->stats.resolve_lazy;
+	*ret = 0;
+	return true;
+}
+
+/* Remember the parent directory of the path if it resolved to itself,
+ * following symbolic links */
+void
+prefix_learn(const char *path, const char *res)
+{
+	int r;
+	size_t len;
+	prefix_t *entry;
+	ht_int64_node_t *node;
+
+	if (!streq(path, res) || (len = prefix_parent(path)) <= 1)
+		return;
+
+	if ((r = hashtable_cache_prepare(&prefixes, 256, PREFIX_MAX, prefix_free_entry)) < 0) {
+		errno = -r;
+		die_errno(-1, "hashtable_create");
+	}
+
+	if (!(node = hashtable_find(prefixes, hash_strn(path, len), 1)))
+		die_errno(-1, "hashtable_find");
+
+	if (!(entry = node->data)) {
+		entry = xcalloc(1, sizeof(prefix_t));
+		node->data = entry;
+	}
+	else if (!strncmp(entry->path, path, len) && entry->path[len] == '\0') {
+		entry->remove_gen = pandora->remove_gen;
+		return;
+	}
+	else
+		free(entry->path);
+
+	entry->path = xstrndup(path, len);
+	entry->remove_gen = pandora->remove_gen;
+}
+
+void
+prefix_free(void)
+{
+	hashtable_cache_free(&prefixes, prefix_free_entry);
+}
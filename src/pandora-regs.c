@@ -0,0 +1,112 @@
+/* vim: set cino= fo=croql sw=8 ts=8 sts=0 noet cin fdm=syntax : */
+
+/*
+ * Copyright (c) 2011 Ali Polatel <alip@exherbo.org>
+ *
+ * This file is part of Pandora's Box. pandora is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * pandora is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "pandora-defs.h"
+
+#include <sys/types.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/ptrace.h>
+
+#include <pinktrace/pink.h>
+#include <pinktrace/easy/pink.h>
+
+/*
+ * Fetch the system call number and the arguments of the process into its
+ * data with a single PTRACE_GETREGS. Architectures without support fall back
+ * to reading the registers one by one using pinktrace.
+ * Returns false and sets errno on failure.
+ */
+bool
+regs_get(pid_t pid, PINK_GCC_ATTR((unused)) pink_bitness_t bit, proc_data_t *data)
+{
+#if PANDORA_HAVE_REGS
+	if (ptrace(PTRACE_GETREGS, pid, NULL, &data->regs) < 0)
+		return false;
+
+#if defined(__x86_64__)
+	data->sno = data->regs.orig_rax;
+	if (bit == PINK_BITNESS_32) {
+		data->args[0] = (uint32_t)data->regs.rbx;
+		data->args[1] = (uint32_t)data->regs.rcx;
+		data->args[2] = (uint32_t)data->regs.rdx;
+		data->args[3] = (uint32_t)data->regs.rsi;
+		data->args[4] = (uint32_t)data->regs.rdi;
+		data->args[5] = (uint32_t)data->regs.rbp;
+	}
+	else {
+		data->args[0] = data->regs.rdi;
+		data->args[1] = data->regs.rsi;
+		data->args[2] = data->regs.rdx;
+		data->args[3] = data->regs.r10;
+		data->args[4] = data->regs.r8;
+		data->args[5] = data->regs.r9;
+	}
+#elif defined(__i386__)
+	data->sno = data->regs.orig_eax;
+	data->args[0] = data->regs.ebx;
+	data->args[1] = data->regs.ecx;
+	data->args[2] = data->regs.edx;
+	data->args[3] = data->regs.esi;
+	data->args[4] = data->regs.edi;
+	data->args[5] = data->regs.ebp;
+#endif
+#else
+	long no;
+
+	if (!pink_util_get_syscall(pid, bit, &no))
+		return false;
+	data->sno = no;
+
+	for (unsigned i = 0; i < PINK_MAX_INDEX; i++) {
+		if (!pink_util_get_arg(pid, bit, i, &data->args[i]))
+			return false;
+	}
+#endif
+	return true;
+}
+
+/*
+ * Write the system call number and optionally the return value back to the
+ * process. The registers saved at system call entry are written back in one
+ * go, this is fine because the system calls we modify are never executed and
+ * only the return value register differs between their entry and exit.
+ * Returns false and sets errno on failure.
+ */
+bool
+regs_set(pid_t pid, PINK_GCC_ATTR((unused)) pink_bitness_t bit, proc_data_t *data, long no, bool ret_set, long ret)
+{
+#if PANDORA_HAVE_REGS
+#if defined(__x86_64__)
+	data->regs.orig_rax = no;
+	if (ret_set)
+		data->regs.rax = ret;
+#elif defined(__i386__)
+	data->regs.orig_eax = no;
+	if (ret_set)
+		data->regs.eax = ret;
+#endif
+	return ptrace(PTRACE_SETREGS, pid, NULL, &data->regs) == 0;
+#else
+	if (!pink_util_set_syscall(pid, bit, no))
+		return false;
+	return ret_set ? pink_util_set_return(pid, ret) : true;
+#endif
+}
@@ -0,0 +1,168 @@
+/* vim: set cino= fo=croql sw=8 ts=8 sts=0 noet cin fdm=syntax : */
+
+/*
+ * Copyright (c) 2011 Ali Polatel <alip@exherbo.org>
+ *
+ * This file is part of Pandora's Box. pandora is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * pandora is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "pandora-defs.h"
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util.h"
+
+/*
+ * Resolving a path costs an lstat() per component and a readlink() per
+ * symbolic link, and processes like compilers resolve the same paths over and
+ * over again. Results, including failures, are cached per process in a small
+ * direct mapped table keyed by the absolute path, i.e. the working directory
+ * or the directory of the file descriptor argument joined with the path
+ * argument, and the resolution mode.
+ *
+ * Entries carry the generation number they were created with. The number is
+ * incremented at the exit of every system call which may change the file
+ * system namespace, whichever traced process makes it, so one rename()
+ * invalidates the caches of all processes. renameat2() and other system calls
+ * which change names without being checked are traced for this alone.
+ *
+ * Changes made by processes which aren't traced go unnoticed, and a stale
+ * entry widens the window between checking a path and its use, which tracing
+ * with ptrace has anyway, to the lifetime of the entry. The generations are
+ * therefore incremented at least once a second, and at every system call once
+ * processes may run untraced: after attaching to processes with -p, and after
+ * a process is resumed by exec/resume_if_match or a panic or violation
+ * decision.
+ *
+ * Paths under /proc are never cached, they depend on the state of processes.
+ */
+#define RESOLVE_CACHE_SIZE	64
+
+static unsigned long
+resolve_hash(const char *path, short mode)
+{
+	return (unsigned long)hash_str(path) ^ (unsigned long)mode;
+}
+
+static bool
+resolve_cacheable(const char *path)
+{
+	return !startswith(path, "/proc") || (path[5] != '/' && path[5] != '\0');
+}
+
+static resolve_entry_t *
+resolve_cache_slot(proc_data_t *data, unsigned long hash)
+{
+	if (!data->rcache)
+		data->rcache = xcalloc(RESOLVE_CACHE_SIZE, sizeof(resolve_entry_t));
+	return &data->rcache[hash % RESOLVE_CACHE_SIZE];
+}
+
+static void
+resolve_entry_clear(resolve_entry_t *entry)
+{
+	if (entry->path)
+		free(entry->path);
+	memset(entry, 0, sizeof(resolve_entry_t));
+}
+
+/*
+ * Look up the resolved form of the absolute path in the cache of the process.
+ * Returns true on a hit and stores the result of the resolution in ret and
+ * the resolved path and its mode in res, the path is valid until the next
+ * call to resolve_cache_store() for the process.
+ */
+bool
+resolve_cache_lookup(proc_data_t *data, const char *path, int maycreat, int resolve,
+		int *ret, resolve_result_t *res)
+{
+	short mode;
+	unsigned long hash;
+	resolve_entry_t *entry;
+
+	mode = (maycreat ? 1 : 0) | (resolve ? 2 : 0);
+	hash = resolve_hash(path, mode);
+	entry = resolve_cache_slot(data, hash);
+
+	if (!entry->path
+			|| entry->gen != pandora->resolve_gen
+			|| entry->hash != hash
+			|| entry->mode != mode
+			|| strcmp(entry->path, path)) {
+		++pandora->stats.resolve_miss;
+		return false;
+	}
+
+	++pandora->stats.resolve_hit;
+	*ret = entry->ret;
+	if (!entry->ret) {
+		res->path = entry->res;
+		res->type = entry->ftype;
+	}
+	return true;
+}
+
+/* Save the result of resolving the absolute path in the cache of the process,
+ * res is NULL if resolving failed */
+void
+resolve_cache_store(proc_data_t *data, const char *path, int maycreat, int resolve,
+		int ret, const resolve_result_t *res)
+{
+	short mode;
+	size_t len, rlen;
+	unsigned long hash;
+	resolve_entry_t *entry;
+
+	/* Out of memory isn't a property of the path */
+	if (ret == -ENOMEM)
+		return;
+	if (!resolve_cacheable(path) || (res && !resolve_cacheable(res->path)))
+		return;
+
+	mode = (maycreat ? 1 : 0) | (resolve ? 2 : 0);
+	hash = resolve_hash(path, mode);
+	entry = resolve_cache_slot(data, hash);
+
+	len = strlen(path) + 1;
+	rlen = res ? strlen(res->path) + 1 : 0;
+	if (entry->size < len + rlen) {
+		resolve_entry_clear(entry);
+		/* Round up so the buffer fits most paths replacing this one */
+		entry->size = (len + rlen + 255) & ~(size_t)255;
+		entry->path = xmalloc(entry->size);
+	}
+
+	entry->hash = hash;
+	entry->gen = pandora->resolve_gen;
+	entry->mode = mode;
+	memcpy(entry->path, path, len);
+	entry->res = res ? memcpy(entry->path + len, res->path, rlen) : NULL;
+	entry->ftype = res ? res->type : 0;
+	entry->ret = ret;
+}
+
+void
+resolve_cache_free(proc_data_t *data)
+{
+	if (!data->rcache)
+		return;
+
+	for (unsigned i = 0; i < RESOLVE_CACHE_SIZE; i++)
+		resolve_entry_clear(&data->rcache[i]);
+	free(data->rcache);
+	data->rcache = NULL;
+}
@@ -33,7 +33,7 @@ sock_info_xdup(sock_info_t *src)
 	assert(src);
 
 	dest = xmalloc(sizeof(sock_info_t));
-	dest->path = src->path ? xstrdup(src->path) : NULL;
+	dest->path = src->path ? intern_ref(src->path) : NULL;
 
 	dest->addr = xmalloc(sizeof(pink_socket_address_t));
 	dest->addr->family = src->addr->family;
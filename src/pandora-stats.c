@@ -0,0 +1,225 @@
+/* vim: set cino= fo=croql sw=8 ts=8 sts=0 noet cin fdm=syntax : */
+
+/*
+ * Copyright (c) 2011 Ali Polatel <alip@exherbo.org>
+ *
+ * This file is part of Pandora's Box. pandora is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * pandora is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "pandora-defs.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <pinktrace/pink.h>
+#include <pinktrace/easy/pink.h>
+
+/* Add the time elapsed since start to the histogram */
+void
+histogram_add(histogram_t *h, unsigned long long start)
+{
+	unsigned n;
+	unsigned long long ns;
+
+	ns = stats_now() - start;
+
+	++h->count;
+	h->total += ns;
+
+	/* log2 rounded down, zero goes to the first bucket */
+	for (n = 0; ns > 1 && n < HISTOGRAM_BUCKETS - 1; n++)
+		ns >>= 1;
+	++h->bucket[n];
+}
+
+static unsigned long long
+histogram_avg(const histogram_t *h)
+{
+	return h->count ? h->total / h->count : 0;
+}
+
+/* Percentage of cache hits */
+static unsigned
+cache_hit_rate(unsigned long long hit, unsigned long long miss)
+{
+	return (hit + miss) ? (unsigned)(hit * 100 / (hit + miss)) : 0;
+}
+
+static void
+dump_one_syscall(const sysentry_t *entry, long no, pink_bitness_t bit, const sysstat_t *stat, void *userdata)
+{
+	FILE *fp = userdata;
+
+	if (!stat->enter.count && !stat->exit.count)
+		return;
+
+	fprintf(fp, "   %s [%s no:%ld]: %llu calls, %llu denied,"
+			" avg enter:%llu ns handler:%llu ns exit:%llu ns\n",
+			entry->name, pink_bitness_name(bit), no,
+			stat->enter.count, stat->denied,
+			histogram_avg(&stat->enter),
+			histogram_avg(&stat->handler),
+			histogram_avg(&stat->exit));
+}
+
+void
+stats_dump(FILE *fp)
+{
+	fprintf(fp, "-- Statistics\n");
+	fprintf(fp, "   System call entries: %llu\n", pandora->stats.sys_enter);
+	fprintf(fp, "   System call exit stops: %llu\n", pandora->stats.sys_exit);
+	fprintf(fp, "   System call exit stops skipped: %llu\n", pandora->stats.sys_exit_skip);
+	fprintf(fp, "   Processes born: %llu, executed: %llu, exited: %llu\n",
+			pandora->stats.proc_birth,
+			pandora->stats.proc_exec,
+			pandora->stats.proc_exit);
+	fprintf(fp, "   Processes traced: %lu (at most %lu at once)\n",
+			pandora->stats.proc_alive,
+			pandora->stats.proc_alive_max);
+	fprintf(fp, "   Path arguments decoded: %llu\n", pandora->stats.mem_paths);
+	fprintf(fp, "   Memory read system calls: %llu (%llu with PTRACE_PEEKDATA)\n",
+			pandora->stats.mem_syscalls, pandora->stats.mem_peeks);
+	fprintf(fp, "   Path resolution: %llu times, avg %llu ns\n",
+			pandora->stats.resolve.count,
+			histogram_avg(&pandora->stats.resolve));
+	fprintf(fp, "   Path resolution cache: %llu hits, %llu misses (%u%%)\n",
+			pandora->stats.resolve_hit,
+			pandora->stats.resolve_miss,
+			cache_hit_rate(pandora->stats.resolve_hit, pandora->stats.resolve_miss));
+	fprintf(fp, "   Paths resolved with openat2: %llu\n", pandora->stats.resolve_openat2);
+	fprintf(fp, "   Paths found canonical without resolving: %llu\n", pandora->stats.resolve_lazy);
+	fprintf(fp, "   Path component cache: %llu hits, %llu misses (%u%%)\n",
+			pandora->stats.dcache_hit,
+			pandora->stats.dcache_miss,
+			cache_hit_rate(pandora->stats.dcache_hit, pandora->stats.dcache_miss));
+	fprintf(fp, "   Directory file descriptor table: %llu hits, %llu misses (%u%%)\n",
+			pandora->stats.fd_hit,
+			pandora->stats.fd_miss,
+			cache_hit_rate(pandora->stats.fd_hit, pandora->stats.fd_miss));
+	fprintf(fp, "   Pattern matching verdict cache: %llu hits, %llu misses (%u%%)\n",
+			pandora->stats.verdict_hit,
+			pandora->stats.verdict_miss,
+			cache_hit_rate(pandora->stats.verdict_hit, pandora->stats.verdict_miss));
+	fprintf(fp, "   Paths rejected by the path list filters: %llu\n",
+			pandora->stats.verdict_filtered);
+	fprintf(fp, "   Pattern set DFA states built: %llu, fallbacks to wildmatch: %llu\n",
+			pandora->stats.patset_dfa_states,
+			pandora->stats.patset_fallback);
+	fprintf(fp, "   Pattern matching: %llu times, avg %llu ns\n",
+			pandora->stats.match.count,
+			histogram_avg(&pandora->stats.match));
+	fprintf(fp, "-- System calls\n");
+	systable_walk(dump_one_syscall, fp);
+}
+
+static void
+json_histogram(FILE *fp, const char *name, const histogram_t *h)
+{
+	unsigned last;
+
+	/* Skip the trailing empty buckets */
+	for (last = HISTOGRAM_BUCKETS; last > 0 && !h->bucket[last - 1]; last--)
+		;
+
+	fprintf(fp, "\"%s\":{\"count\":%llu,\"total_ns\":%llu,\"log2_ns\":[",
+			name, h->count, h->total);
+	for (unsigned i = 0; i < last; i++)
+		fprintf(fp, "%s%llu", i ? "," : "", h->bucket[i]);
+	fprintf(fp, "]}");
+}
+
+struct json_ctx {
+	FILE *fp;
+	bool first;
+};
+
+static void
+json_one_syscall(const sysentry_t *entry, long no, pink_bitness_t bit, const sysstat_t *stat, void *userdata)
+{
+	struct json_ctx *ctx = userdata;
+	FILE *fp = ctx->fp;
+
+	if (!stat->enter.count && !stat->exit.count)
+		return;
+
+	fprintf(fp, "%s\n  {\"name\":\"%s\",\"bitness\":\"%s\",\"no\":%ld,\"denied\":%llu,",
+			ctx->first ? "" : ",",
+			entry->name, pink_bitness_name(bit), no,
+			stat->denied);
+	json_histogram(fp, "enter", &stat->enter);
+	fputc(',', fp);
+	json_histogram(fp, "handler", &stat->handler);
+	fputc(',', fp);
+	json_histogram(fp, "exit", &stat->exit);
+	fputc('}', fp);
+	ctx->first = false;
+}
+
+/*
+ * Write the statistics to the given file as JSON.
+ * Returns 0 on success, negated errno on failure.
+ */
+int
+stats_write_json(const char *path)
+{
+	FILE *fp;
+	struct json_ctx ctx;
+
+	if (!(fp = fopen(path, "w")))
+		return -errno;
+
+	fprintf(fp, "{\"sys_enter\":%llu,\"sys_exit\":%llu,\"sys_exit_skip\":%llu,\n",
+			pandora->stats.sys_enter,
+			pandora->stats.sys_exit,
+			pandora->stats.sys_exit_skip);
+	fprintf(fp, " \"proc_birth\":%llu,\"proc_exec\":%llu,\"proc_exit\":%llu,\"proc_alive_max\":%lu,\n",
+			pandora->stats.proc_birth,
+			pandora->stats.proc_exec,
+			pandora->stats.proc_exit,
+			pandora->stats.proc_alive_max);
+	fprintf(fp, " \"mem_paths\":%llu,\"mem_syscalls\":%llu,\"mem_peeks\":%llu,\n",
+			pandora->stats.mem_paths,
+			pandora->stats.mem_syscalls,
+			pandora->stats.mem_peeks);
+	fprintf(fp, " \"resolve_hit\":%llu,\"resolve_miss\":%llu,\"resolve_openat2\":%llu,\"resolve_lazy\":%llu,"
+			"\"dcache_hit\":%llu,\"dcache_miss\":%llu,\"fd_hit\":%llu,\"fd_miss\":%llu,"
+			"\"verdict_hit\":%llu,\"verdict_miss\":%llu,\"verdict_filtered\":%llu,"
+			"\"patset_dfa_states\":%llu,\"patset_fallback\":%llu,\n ",
+			pandora->stats.resolve_hit,
+			pandora->stats.resolve_miss,
+			pandora->stats.resolve_openat2,
+			pandora->stats.resolve_lazy,
+			pandora->stats.dcache_hit,
+			pandora->stats.dcache_miss,
+			pandora->stats.fd_hit,
+			pandora->stats.fd_miss,
+			pandora->stats.verdict_hit,
+			pandora->stats.verdict_miss,
+			pandora->stats.verdict_filtered,
+			pandora->stats.patset_dfa_states,
+			pandora->stats.patset_fallback);
+	json_histogram(fp, "resolve", &pandora->stats.resolve);
+	fprintf(fp, ",\n ");
+	json_histogram(fp, "match", &pandora->stats.match);
+	fprintf(fp, ",\n \"syscalls\":[");
+	ctx.fp = fp;
+	ctx.first = true;
+	systable_walk(json_one_syscall, &ctx);
+	fprintf(fp, "]}\n");
+
+	if (fclose(fp) == EOF)
+		return -errno;
+	return 0;
+}
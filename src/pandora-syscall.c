@@ -29,105 +29,170 @@
 #include <pinktrace/pink.h>
 #include <pinktrace/easy/pink.h>
 
+#include "macro.h"
 #include "proc.h"
 
-void
-sysinit(void)
+static const sysentry_t syscall_entries[] = {
+	{"chdir", sys_chdir, sysx_chdir, MUTATE_NONE},
+	{"fchdir", sys_chdir, sysx_chdir, MUTATE_NONE},
+
+	{"stat", sys_stat, NULL, MUTATE_NONE},
+	{"stat64", sys_stat, NULL, MUTATE_NONE},
+	{"lstat", sys_stat, NULL, MUTATE_NONE},
+	{"lstat64", sys_stat, NULL, MUTATE_NONE},
+
+	{"access", sys_access, NULL, MUTATE_NONE},
+	{"faccessat", sys_faccessat, NULL, MUTATE_NONE},
+
+	{"dup", sys_dup, sysx_dup, MUTATE_NONE},
+	{"dup2", sys_dup, sysx_dup, MUTATE_NONE},
+	{"dup3", sys_dup, sysx_dup, MUTATE_NONE},
+	{"fcntl", sys_fcntl, sysx_fcntl, MUTATE_NONE},
+	{"fcntl64", sys_fcntl, sysx_fcntl, MUTATE_NONE},
+
+	{"execve", sys_execve, NULL, MUTATE_NONE},
+
+	{"chmod", sys_chmod, NULL, MUTATE_ATTR},
+	{"fchmodat", sys_fchmodat, NULL, MUTATE_ATTR},
+	{"fchmodat2", NULL, NULL, MUTATE_ATTR},
+	{"fchmod", NULL, NULL, MUTATE_ATTR},
+
+	{"chown", sys_chown, NULL, MUTATE_ATTR},
+	{"chown32", sys_chown, NULL, MUTATE_ATTR},
+	{"lchown", sys_lchown, NULL, MUTATE_ATTR},
+	{"lchown32", sys_lchown, NULL, MUTATE_ATTR},
+	{"fchownat", sys_fchownat, NULL, MUTATE_ATTR},
+	{"fchown", NULL, NULL, MUTATE_ATTR},
+	{"fchown32", NULL, NULL, MUTATE_ATTR},
+
+	{"open", sys_open, NULL, MUTATE_OPEN},
+	{"openat", sys_openat, NULL, MUTATE_OPENAT},
+	{"creat", sys_creat, NULL, MUTATE_CREATE},
+
+	{"mkdir", sys_mkdir, NULL, MUTATE_CREATE},
+	{"mkdirat", sys_mkdirat, NULL, MUTATE_CREATE},
+
+	{"mknod", sys_mknod, NULL, MUTATE_CREATE},
+	{"mknodat", sys_mknodat, NULL, MUTATE_CREATE},
+
+	{"rmdir", sys_rmdir, NULL, MUTATE_REMOVE},
+
+	{"truncate", sys_truncate, NULL, MUTATE_NONE},
+	{"truncate64", sys_truncate, NULL, MUTATE_NONE},
+
+	{"mount", sys_mount, NULL, MUTATE_REMOVE},
+	{"umount", sys_umount, NULL, MUTATE_REMOVE},
+	{"umount2", sys_umount2, NULL, MUTATE_REMOVE},
+
+	{"utime", sys_utime, NULL, MUTATE_NONE},
+	{"utimes", sys_utimes, NULL, MUTATE_NONE},
+	{"utimensat", sys_utimensat, NULL, MUTATE_NONE},
+	{"futimesat", sys_futimesat, NULL, MUTATE_NONE},
+
+	{"unlink", sys_unlink, NULL, MUTATE_REMOVE},
+	{"unlinkat", sys_unlinkat, NULL, MUTATE_REMOVE},
+
+	{"link", sys_link, NULL, MUTATE_CREATE},
+	{"linkat", sys_linkat, NULL, MUTATE_CREATE},
+
+	{"rename", sys_rename, NULL, MUTATE_REMOVE},
+	{"renameat", sys_renameat, NULL, MUTATE_REMOVE},
+
+	/* Not checked, traced only to invalidate path resolution caches */
+	{"renameat2", NULL, NULL, MUTATE_REMOVE},
+	{"pivot_root", NULL, NULL, MUTATE_REMOVE},
+	{"move_mount", NULL, NULL, MUTATE_REMOVE},
+
+	{"symlink", sys_symlink, NULL, MUTATE_CREATE},
+	{"symlinkat", sys_symlinkat, NULL, MUTATE_CREATE},
+
+	{"setxattr", sys_setxattr, NULL, MUTATE_ATTR},
+	{"lsetxattr", sys_lsetxattr, NULL, MUTATE_ATTR},
+	{"removexattr", sys_removexattr, NULL, MUTATE_ATTR},
+	{"lremovexattr", sys_lremovexattr, NULL, MUTATE_ATTR},
+	{"fsetxattr", NULL, NULL, MUTATE_ATTR},
+	{"fremovexattr", NULL, NULL, MUTATE_ATTR},
+
+	{"socketcall", sys_socketcall, sysx_socketcall, MUTATE_SOCKETCALL},
+	{"bind", sys_bind, sysx_bind, MUTATE_CREATE},
+	{"connect", sys_connect, NULL, MUTATE_NONE},
+	{"sendto", sys_sendto, NULL, MUTATE_NONE},
+	{"recvfrom", sys_recvfrom, NULL, MUTATE_NONE},
+	{"getsockname", sys_getsockname, sysx_getsockname, MUTATE_NONE},
+};
+
+/* Only stopped for if core/trace/track_fds is set at startup */
+static const sysentry_t track_fds_entries[] = {
+	{"close", sys_close, NULL, MUTATE_NONE},
+	{"close_range", sys_close_range, NULL, MUTATE_NONE},
+};
+
+/* Does the system call about to be made change the file system namespace? */
+static bool
+sysmutate(const sysentry_t *entry, const proc_data_t *data)
 {
-	systable_add("chdir", NULL, sysx_chdir);
-	systable_add("fchdir", NULL, sysx_chdir);
-
-	systable_add("stat", sys_stat, NULL);
-	systable_add("stat64", sys_stat, NULL);
-	systable_add("lstat", sys_stat, NULL);
-	systable_add("lstat64", sys_stat, NULL);
-
-	systable_add("access", sys_access, NULL);
-	systable_add("faccessat", sys_faccessat, NULL);
-
-	systable_add("dup", sys_dup, sysx_dup);
-	systable_add("dup2", sys_dup, sysx_dup);
-	systable_add("dup3", sys_dup, sysx_dup);
-	systable_add("fcntl", sys_fcntl, sysx_fcntl);
-	systable_add("fcntl64", sys_fcntl, sysx_fcntl);
-
-	systable_add("execve", sys_execve, NULL);
-
-	systable_add("chmod", sys_chmod, NULL);
-	systable_add("fchmodat", sys_fchmodat, NULL);
-
-	systable_add("chown", sys_chown, NULL);
-	systable_add("chown32", sys_chown, NULL);
-	systable_add("lchown", sys_lchown, NULL);
-	systable_add("lchown32", sys_lchown, NULL);
-	systable_add("fchownat", sys_fchownat, NULL);
-
-	systable_add("open", sys_open, NULL);
-	systable_add("openat", sys_openat, NULL);
-	systable_add("creat", sys_creat, NULL);
-
-	systable_add("mkdir", sys_mkdir, NULL);
-	systable_add("mkdirat", sys_mkdirat, NULL);
-
-	systable_add("mknod", sys_mknod, NULL);
-	systable_add("mknodat", sys_mknodat, NULL);
-
-	systable_add("rmdir", sys_rmdir, NULL);
-
-	systable_add("truncate", sys_truncate, NULL);
-	systable_add("truncate64", sys_truncate, NULL);
-
-	systable_add("mount", sys_mount, NULL);
-	systable_add("umount", sys_umount, NULL);
-	systable_add("umount2", sys_umount2, NULL);
-
-	systable_add("utime", sys_utime, NULL);
-	systable_add("utimes", sys_utimes, NULL);
-	systable_add("utimensat", sys_utimensat, NULL);
-	systable_add("futimesat", sys_futimesat, NULL);
-
-	systable_add("unlink", sys_unlink, NULL);
-	systable_add("unlinkat", sys_unlinkat, NULL);
-
-	systable_add("link", sys_link, NULL);
-	systable_add("linkat", sys_linkat, NULL);
-
-	systable_add("rename", sys_rename, NULL);
-	systable_add("renameat", sys_renameat, NULL);
+	switch (entry->mutate) {
+	case MUTATE_CREATE:
+	case MUTATE_REMOVE:
+	case MUTATE_ATTR:
+		return true;
+	case MUTATE_OPEN:
+		return !!(data->args[1] & O_CREAT);
+	case MUTATE_OPENAT:
+		return !!(data->args[2] & O_CREAT);
+	case MUTATE_SOCKETCALL:
+		return data->args[0] == PINK_SOCKET_SUBCALL_BIND;
+	case MUTATE_NONE:
+	default:
+		return false;
+	}
+}
 
-	systable_add("symlink", sys_symlink, NULL);
-	systable_add("symlinkat", sys_symlinkat, NULL);
+/*
+ * Longest time path resolution cache entries are used for, in nanoseconds.
+ * Changes made by processes which aren't traced don't increment the
+ * generations, see pandora-resolve.c.
+ */
+#define GEN_LIFETIME	1000000000ULL
 
-	systable_add("setxattr", sys_setxattr, NULL);
-	systable_add("lsetxattr", sys_lsetxattr, NULL);
-	systable_add("removexattr", sys_removexattr, NULL);
-	systable_add("lremovexattr", sys_lremovexattr, NULL);
+void
+sysinit(void)
+{
+	for (unsigned i = 0; i < ELEMENTSOF(syscall_entries); i++)
+		systable_add(&syscall_entries[i]);
 
-	systable_add("socketcall", sys_socketcall, sysx_socketcall);
-	systable_add("bind", sys_bind, sysx_bind);
-	systable_add("connect", sys_connect, NULL);
-	systable_add("sendto", sys_sendto, NULL);
-	systable_add("recvfrom", sys_recvfrom, NULL);
-	systable_add("getsockname", sys_getsockname, sysx_getsockname);
+	if (pandora->config.track_fds) {
+		for (unsigned i = 0; i < ELEMENTSOF(track_fds_entries); i++)
+			systable_add(&track_fds_entries[i]);
+	}
 }
 
 int
 sysenter(pink_easy_process_t *current)
 {
-	long no;
+	int r;
+	unsigned long long start, hstart;
 	const char *name;
 	pid_t pid;
 	pink_bitness_t bit;
 	proc_data_t *data;
 	const sysentry_t *entry;
+	sysstat_t *stat;
+
+	start = stats_now();
+	if (pandora->untraced || start - pandora->gen_start > GEN_LIFETIME) {
+		++pandora->resolve_gen;
+		++pandora->remove_gen;
+		pandora->gen_start = start;
+	}
 
 	pid = pink_easy_process_get_pid(current);
 	bit = pink_easy_process_get_bitness(current);
 	data = pink_easy_process_get_userdata(current);
 
-	if (!pink_util_get_syscall(pid, bit, &no)) {
+	if (!regs_get(pid, bit, data)) {
 		if (errno != ESRCH) {
-			warning("pink_util_get_syscall(%d, %s): %d(%s)",
+			warning("regs_get(%d, %s): %d(%s)",
 					pid, pink_bitness_name(bit),
 					errno, strerror(errno));
 			return panic(current);
@@ -135,38 +200,101 @@ sysenter(pink_easy_process_t *current)
 		return PINK_EASY_CFLAG_DROP;
 	}
 
-	data->sno = no;
-	entry = systable_lookup(no, bit);
+	entry = systable_lookup(data->sno, bit);
 	if (entry)
 		debug("process:%lu is entering system call \"%s\"",
 				(unsigned long)pid,
 				entry->name);
 	else {
-		name = pink_name_syscall(no, bit);
+		name = pink_name_syscall(data->sno, bit);
 		trace("process:%lu is entering system call \"%s\"",
 				(unsigned long)pid,
 				name ? name : "???");
 	}
 
-	return (entry && entry->enter) ? entry->enter(current, entry->name) : 0;
+	if (!entry)
+		return 0;
+
+	stat = systable_stat(data->sno, bit);
+	if (entry->enter) {
+		hstart = stats_now();
+		r = entry->enter(current, entry->name);
+		histogram_add(&stat->handler, hstart);
+	}
+	else
+		r = 0;
+	if (!data->deny)
+		data->mutate = sysmutate(entry, data);
+	histogram_add(&stat->enter, start);
+	return r;
+}
+
+/*
+ * Called after sysenter() at a seccomp stop to decide whether the process has
+ * to stop at system call exit. That's only the case for system calls with an
+ * exit handler, for those which change the file system namespace and for those
+ * opening a directory, denied system calls are skipped here.
+ */
+int
+sysenter_done(pink_easy_process_t *current, bool *exit_stop)
+{
+	int r;
+	const sysentry_t *entry;
+	pink_bitness_t bit = pink_easy_process_get_bitness(current);
+	proc_data_t *data = pink_easy_process_get_userdata(current);
+
+	if (data->deny) {
+		r = skip(current);
+		*exit_stop = false;
+		goto end;
+	}
+
+	entry = systable_lookup(data->sno, bit);
+	if (data->mutate || data->opendir || (entry && entry->exit)) {
+		*exit_stop = true;
+		return 0;
+	}
+
+	r = 0;
+	*exit_stop = false;
+end:
+	clear_proc(data);
+	return r;
 }
 
 int
 sysexit(pink_easy_process_t *current)
 {
 	int r;
+	unsigned long long start;
 	const sysentry_t *entry;
+	sysstat_t *stat;
 	pink_bitness_t bit = pink_easy_process_get_bitness(current);
 	proc_data_t *data = pink_easy_process_get_userdata(current);
 
+	start = stats_now();
 	if (data->deny) {
 		r = restore(current);
 		goto end;
 	}
 
 	entry = systable_lookup(data->sno, bit);
+
+	/* Invalidate the path resolution caches of all processes */
+	if (data->mutate) {
+		++pandora->resolve_gen;
+		if (entry && entry->mutate == MUTATE_REMOVE)
+			++pandora->remove_gen;
+	}
+
+	/* Remember the opened directory, see pandora-fd.c */
+	if (data->opendir && (r = fdtable_opendir(current)))
+		goto end;
+
 	r = (entry && entry->exit) ? entry->exit(current, entry->name) : 0;
 end:
+	if ((stat = systable_stat(data->sno, bit)))
+		histogram_add(&stat->exit, start);
 	clear_proc(data);
 	return r;
 }
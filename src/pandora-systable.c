@@ -1,7 +1,7 @@
 /* vim: set cino= fo=croql sw=8 ts=8 sts=0 noet cin fdm=syntax : */
 
 /*
- * Copyright (c) 2010 Ali Polatel <alip@exherbo.org>
+ * Copyright (c) 2010, 2011 Ali Polatel <alip@exherbo.org>
  *
  * This file is part of Pandora's Box. pandora is free software;
  * you can redistribute it and/or modify it under the terms of the GNU General
@@ -22,58 +22,81 @@
 #include <assert.h>
 #include <errno.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <pinktrace/pink.h>
 #include <pinktrace/easy/pink.h>
 
-#include "hashtable.h"
+/*
+ * System call tables are indexed by system call number, a NULL slot means the
+ * system call isn't interesting. Lookups are a bounds check and a load.
+ *
+ * The numbers are resolved once at startup using pinktrace's name tables,
+ * rather than the __NR_* constants, because the secondary personality
+ * (e.g. i386 under x86_64) has no constants in the host headers.
+ *
+ * Statistics of each system call are kept in a parallel array.
+ */
+typedef struct {
+	unsigned long size;
+	const sysentry_t **entries;
+	sysstat_t *stats;
+} systable_t;
 
 #if PINKTRACE_BITNESS_32_SUPPORTED
-static hashtable_t *systable32 = NULL;
+static systable_t systable32;
 #endif
 #if PINKTRACE_BITNESS_64_SUPPORTED
-static hashtable_t *systable64 = NULL;
+static systable_t systable64;
 #endif
 
-static void
-systable_add_full(long no, pink_bitness_t bit, const char *name, sysfunc_t fenter, sysfunc_t fexit)
+inline
+static systable_t *
+systable_get(pink_bitness_t bit)
 {
-	sysentry_t *entry;
-
-	entry = xmalloc(sizeof(sysentry_t));
-	entry->name = name;
-	entry->enter = fenter;
-	entry->exit = fexit;
-
 #if PINKTRACE_BITNESS_32_SUPPORTED
-	if (bit == PINK_BITNESS_32) {
-		ht_int32_node_t *node32 = hashtable_find(systable32, no, 1);
-		node32->data = entry;
-	}
+	if (bit == PINK_BITNESS_32)
+		return &systable32;
 #endif
 #if PINKTRACE_BITNESS_64_SUPPORTED
-	if (bit == PINK_BITNESS_64) {
-		ht_int64_node_t *node64 = hashtable_find(systable64, no, 1);
-		node64->data = entry;
-	}
+	if (bit == PINK_BITNESS_64)
+		return &systable64;
 #endif
+	return NULL;
+}
+
+static void
+systable_add_full(long no, pink_bitness_t bit, const sysentry_t *entry)
+{
+	unsigned long size;
+	systable_t *tbl;
+
+	assert(no >= 0);
+
+	tbl = systable_get(bit);
+	assert(tbl);
+
+	if ((unsigned long)no >= tbl->size) {
+		/* Grow in steps to avoid reallocating for every entry */
+		size = ((unsigned long)no + 64) & ~63UL;
+		tbl->entries = xrealloc(tbl->entries, size * sizeof(sysentry_t *));
+		memset(tbl->entries + tbl->size, 0, (size - tbl->size) * sizeof(sysentry_t *));
+		tbl->stats = xrealloc(tbl->stats, size * sizeof(sysstat_t));
+		memset(tbl->stats + tbl->size, 0, (size - tbl->size) * sizeof(sysstat_t));
+		tbl->size = size;
+	}
+
+	tbl->entries[no] = entry;
 }
 
 void
 systable_init(void)
 {
-	int r;
 #if PINKTRACE_BITNESS_32_SUPPORTED
-	if ((r = hashtable_create(64, 0, &systable32) < 0)) {
-		errno = -r;
-		die_errno(-1, "hashtable_create");
-	}
+	memset(&systable32, 0, sizeof(systable_t));
 #endif
 #if PINKTRACE_BITNESS_64_SUPPORTED
-	if ((r = hashtable_create(64, 1, &systable64)) < 0) {
-		errno = -r;
-		die_errno(-1, "hashtable_create");
-	}
+	memset(&systable64, 0, sizeof(systable_t));
 #endif
 }
 
@@ -81,57 +104,105 @@ void
 systable_free(void)
 {
 #if PINKTRACE_BITNESS_32_SUPPORTED
-	for (int i = 0; i < systable32->size; i++) {
-		ht_int32_node_t *node = HT_NODE(systable32, systable32->nodes, i);
-		if (node->data)
-			free(node->data);
-	}
-
-	hashtable_destroy(systable32);
+	free(systable32.entries);
+	free(systable32.stats);
+	memset(&systable32, 0, sizeof(systable_t));
 #endif
 #if PINKTRACE_BITNESS_64_SUPPORTED
-	for (int j = 0; j < systable64->size; j++) {
-		ht_int64_node_t *node = HT_NODE(systable64, systable64->nodes, j);
-		if (node->data)
-			free(node->data);
-	}
-
-	hashtable_destroy(systable64);
+	free(systable64.entries);
+	free(systable64.stats);
+	memset(&systable64, 0, sizeof(systable_t));
 #endif
 }
 
 void
-systable_add(const char *name, sysfunc_t fenter, sysfunc_t fexit)
+systable_add(const sysentry_t *entry)
 {
 	long no;
 
 #if PINKTRACE_BITNESS_32_SUPPORTED
-	no = pink_name_lookup(name, PINK_BITNESS_32);
-	if (no > 0)
-		systable_add_full(no, PINK_BITNESS_32, name, fenter, fexit);
+	no = pink_name_lookup(entry->name, PINK_BITNESS_32);
+	if (no >= 0)
+		systable_add_full(no, PINK_BITNESS_32, entry);
 #endif /* PINKTRACE_BITNESS_32_SUPPORTED */
 
 #if PINKTRACE_BITNESS_64_SUPPORTED
-	no = pink_name_lookup(name, PINK_BITNESS_64);
-	if (no > 0)
-		systable_add_full(no, PINK_BITNESS_64, name, fenter, fexit);
+	no = pink_name_lookup(entry->name, PINK_BITNESS_64);
+	if (no >= 0)
+		systable_add_full(no, PINK_BITNESS_64, entry);
 #endif /* PINKTRACE_BITNESS_64_SUPPORTED */
 }
 
+/*
+ * Allocate an array of the system call numbers registered for the given
+ * bitness and return its length, used to generate the seccomp filter.
+ */
+unsigned
+systable_list(pink_bitness_t bit, long **list)
+{
+	unsigned count;
+	systable_t *tbl;
+
+	assert(list);
+
+	if (!(tbl = systable_get(bit)) || !tbl->size) {
+		*list = NULL;
+		return 0;
+	}
+
+	count = 0;
+	*list = xmalloc(tbl->size * sizeof(long));
+	for (unsigned long i = 0; i < tbl->size; i++) {
+		if (tbl->entries[i])
+			(*list)[count++] = (long)i;
+	}
+
+	return count;
+}
+
 const sysentry_t *
 systable_lookup(long no, pink_bitness_t bit)
 {
 #if PINKTRACE_BITNESS_32_SUPPORTED
-	if (bit == PINK_BITNESS_32) {
-		ht_int32_node_t *node = hashtable_find(systable32, no, 0);
-		return node ? node->data : NULL;
+	if (bit == PINK_BITNESS_32)
+		return ((unsigned long)no < systable32.size) ? systable32.entries[no] : NULL;
+#endif
+#if PINKTRACE_BITNESS_64_SUPPORTED
+	if (bit == PINK_BITNESS_64)
+		return ((unsigned long)no < systable64.size) ? systable64.entries[no] : NULL;
+#endif
+	return NULL;
+}
+
+sysstat_t *
+systable_stat(long no, pink_bitness_t bit)
+{
+	systable_t *tbl = systable_get(bit);
+
+	if (!tbl || (unsigned long)no >= tbl->size || !tbl->entries[no])
+		return NULL;
+	return &tbl->stats[no];
+}
+
+void
+systable_walk(systable_walk_func_t func, void *userdata)
+{
+	systable_t *tbl;
+
+	assert(func);
+
+#if PINKTRACE_BITNESS_32_SUPPORTED
+	tbl = &systable32;
+	for (unsigned long i = 0; i < tbl->size; i++) {
+		if (tbl->entries[i])
+			func(tbl->entries[i], (long)i, PINK_BITNESS_32, &tbl->stats[i], userdata);
 	}
 #endif
 #if PINKTRACE_BITNESS_64_SUPPORTED
-	if (bit == PINK_BITNESS_64) {
-		ht_int64_node_t *node = hashtable_find(systable64, no, 0);
-		return node ? node->data : NULL;
+	tbl = &systable64;
+	for (unsigned long i = 0; i < tbl->size; i++) {
+		if (tbl->entries[i])
+			func(tbl->entries[i], (long)i, PINK_BITNESS_64, &tbl->stats[i], userdata);
 	}
 #endif
-	return NULL;
 }
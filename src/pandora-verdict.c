@@ -0,0 +1,255 @@
+/* vim: set cino= fo=croql sw=8 ts=8 sts=0 noet cin fdm=syntax : */
+
+/*
+ * Copyright (c) 2011 Ali Polatel <alip@exherbo.org>
+ *
+ * This file is part of Pandora's Box. pandora is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * pandora is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "pandora-defs.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "hashtable.h"
+#include "util.h"
+
+/*
+ * Whether a path matches a list of patterns depends on the patterns and the
+ * path only, yet the same paths keep being matched against the same lists:
+ * every compiler checks the same headers. The verdicts are cached here,
+ * shared by all processes of the tracer.
+ *
+ * Entries are keyed by a hash of the path lists of the sandbox, the list the
+ * path is matched against and the interned path. The hash of the lists is
+ * kept in sandbox_t, it is the sum of the hashes of the intern ids of the
+ * patterns, see verdict_rehash(). Processes with the same lists share
+ * entries, and changing a list with a magic command changes the hash, which
+ * invalidates the entries of the old lists.
+ *
+ * Patterns under /proc are left out of the hash and paths under /proc are
+ * never cached. Such patterns only match such paths, and leaving them out
+ * keeps the per process directories of core/whitelist/per_process_directories
+ * from making the lists of every process differ.
+ *
+ * The table is a cache, see hashtable.h.
+ */
+#define VERDICT_MAX	65536
+
+typedef struct {
+	unsigned long long listhash;
+	int list;
+	const char *path;
+	int match;
+} verdict_t;
+
+static hashtable_t *verdicts;
+
+static uint64_t
+verdict_mix(uint64_t h)
+{
+	/* splitmix64 finalizer */
+	h ^= h >> 30;
+	h *= 0xbf58476d1ce4e5b9ULL;
+	h ^= h >> 27;
+	h *= 0x94d049bb133111ebULL;
+	h ^= h >> 31;
+	return h;
+}
+
+static int64
+verdict_key(unsigned long long listhash, int list, unsigned long id)
+{
+	uint64_t h;
+
+	h = verdict_mix(listhash ^ verdict_mix(((uint64_t)id << 3) | (unsigned)list));
+	return h ? (int64)h : 1;
+}
+
+static bool
+verdict_cacheable(const char *path)
+{
+	return !startswith(path, "/proc") || (path[5] != '/' && path[5] != '\0');
+}
+
+static void
+verdict_free_entry(void *data)
+{
+	verdict_t *entry = data;
+
+	if (!entry)
+		return;
+	intern_release(entry->path);
+	free(entry);
+}
+
+void
+verdict_free(void)
+{
+	hashtable_cache_free(&verdicts, verdict_free_entry);
+}
+
+/* Recalculate the hash of the path lists after they are changed */
+void
+verdict_rehash(sandbox_t *box)
+{
+	int list;
+	struct snode *node;
+
+	box->listhash = 0;
+	for (list = 0; list < PATH_LIST_MAX; list++) {
+		SLIST_FOREACH(node, box_path_list(box, list), up) {
+			if (startswith(node->data, "/proc/"))
+				continue;
+			box->listhash += verdict_mix(((uint64_t)intern_id(node->data) << 3) | (unsigned)list);
+		}
+	}
+}
+
+/*
+ * Most paths match none of the patterns of a list, e.g. every path is checked
+ * against the blacklists in allow mode. Such paths are mostly rejected by a
+ * filter of the list before any matching.
+ *
+ * A path can only match a pattern if it starts with the literal prefix of the
+ * pattern. The filter counts the patterns by a hash of the first components
+ * of their literal prefix, up to VERDICT_FILTER_DEPTH components. A path which
+ * has none of its first components in the filter matches none of the patterns,
+ * unless there are patterns with no literal component to start with, like
+ * `**' or `*.o', which are counted in wild.
+ *
+ * Components end before a slash, or at the end of a fully literal pattern. The
+ * bare directory matched by a pattern ending with a slash and `***' ends where
+ * the slash of the pattern is, so it is found by the same hash.
+ *
+ * The filter is updated as patterns are added and removed with magic commands,
+ * see pandora-magic.c. A count which reaches 255 is never decremented again.
+ */
+static unsigned
+verdict_filter_hash(uint64_t h)
+{
+	return verdict_mix(h) & (VERDICT_FILTER_SIZE - 1);
+}
+
+void
+verdict_filter_update(verdict_filter_t *filter, const char *pattern, int delta)
+{
+	int depth;
+	bool anchored;
+	uint64_t h, anchor;
+	const char *p;
+
+	depth = 0;
+	anchored = false;
+	h = anchor = HASH_STR_SEED;
+	for (p = pattern; depth < VERDICT_FILTER_DEPTH; p++) {
+		if (*p == '*' || *p == '?' || *p == '[' || *p == '\\')
+			break;
+		if (p > pattern && (*p == '/' || *p == '\0')) {
+			anchor = h;
+			anchored = true;
+			depth++;
+		}
+		if (*p == '\0')
+			break;
+		h = HASH_STR_STEP(h, *p);
+	}
+
+	if (!anchored)
+		filter->wild += delta;
+	else if (filter->count[verdict_filter_hash(anchor)] != 255)
+		filter->count[verdict_filter_hash(anchor)] += delta;
+}
+
+/* Returns false if the path matches none of the patterns of the filter */
+static bool
+verdict_filter_maybe(const verdict_filter_t *filter, const char *path)
+{
+	int depth;
+	uint64_t h;
+	const char *p;
+
+	if (filter->wild)
+		return true;
+
+	depth = 0;
+	h = HASH_STR_SEED;
+	for (p = path; depth < VERDICT_FILTER_DEPTH; p++) {
+		if (p > path && (*p == '/' || *p == '\0')) {
+			if (filter->count[verdict_filter_hash(h)])
+				return true;
+			depth++;
+		}
+		if (*p == '\0')
+			break;
+		h = HASH_STR_STEP(h, *p);
+	}
+	return false;
+}
+
+/*
+ * Match the path against the patterns, which are one of the path lists of the
+ * sandbox, or any other list which isn't cached.
+ * Returns nonzero if the path matches.
+ */
+int
+verdict_match(sandbox_t *box, const slist_t *patterns, const char *path)
+{
+	int r, list;
+	const char *ipath;
+	verdict_t *entry;
+	ht_int64_node_t *node;
+
+	if ((list = box_path_list_index(box, patterns)) < 0)
+		return box_match_path(path, patterns, NULL);
+
+	if (!verdict_filter_maybe(&box->filter[list], path)) {
+		++pandora->stats.verdict_filtered;
+		return 0;
+	}
+
+	if (!verdict_cacheable(path))
+		return box_match_path(path, patterns, NULL);
+
+	if ((r = hashtable_cache_prepare(&verdicts, 1024, VERDICT_MAX, verdict_free_entry)) < 0) {
+		errno = -r;
+		die_errno(-1, "hashtable_create");
+	}
+
+	ipath = intern(path);
+	if (!(node = hashtable_find(verdicts, verdict_key(box->listhash, list, intern_id(ipath)), 1)))
+		die_errno(-1, "hashtable_find");
+
+	entry = node->data;
+	if (entry && entry->listhash == box->listhash && entry->list == list && entry->path == ipath) {
+		++pandora->stats.verdict_hit;
+		intern_release(ipath);
+		return entry->match;
+	}
+	++pandora->stats.verdict_miss;
+
+	r = patset_match(box_patset(box, list), path, NULL);
+
+	if (entry)
+		intern_release(entry->path);
+	else
+		entry = node->data = xmalloc(sizeof(verdict_t));
+	entry->listhash = box->listhash;
+	entry->list = list;
+	entry->path = ipath;
+	entry->match = r;
+
+	return r;
+}
@@ -65,8 +65,14 @@
 
 #include "macro.h"
 #include "util.h"
+#if PANDORA_HAVE_SECCOMP
+#include "seccomp.h"
+#endif
 
 pandora_t *pandora = NULL;
+#if PANDORA_HAVE_SECCOMP
+static seccomp_filter_t *filter = NULL;
+#endif
 
 static void
 about(void)
@@ -103,6 +109,13 @@ pandora_init(void)
 	pandora->exit_code = 0;
 	pandora->violation = false;
 	pandora->ctx = NULL;
+	pandora->resolve_gen = 0;
+	pandora->remove_gen = 0;
+	pandora->gen_start = 0;
+	pandora->untraced = false;
+	pandora->attach_tids = NULL;
+	pandora->attach_pending = 0;
+	memset(&pandora->stats, 0, sizeof(stats_t));
 	config_init();
 }
 
@@ -116,20 +129,35 @@ pandora_destroy(void)
 	/* Free the global configuration */
 	free_sandbox(&pandora->config.child);
 
-	SLIST_FLUSH(node, &pandora->config.exec_kill_if_match, up, free);
-	SLIST_FLUSH(node, &pandora->config.exec_resume_if_match, up, free);
+	SLIST_FLUSH(node, &pandora->config.exec_kill_if_match, up, intern_release);
+	SLIST_FLUSH(node, &pandora->config.exec_resume_if_match, up, intern_release);
 
-	SLIST_FLUSH(node, &pandora->config.filter_exec, up, free);
-	SLIST_FLUSH(node, &pandora->config.filter_read, up, free);
-	SLIST_FLUSH(node, &pandora->config.filter_write, up, free);
+	SLIST_FLUSH(node, &pandora->config.filter_exec, up, intern_release);
+	SLIST_FLUSH(node, &pandora->config.filter_read, up, intern_release);
+	SLIST_FLUSH(node, &pandora->config.filter_write, up, intern_release);
 	SLIST_FLUSH(node, &pandora->config.filter_sock, up, free_sock_match);
 
+	if (pandora->config.stats_file)
+		free(pandora->config.stats_file);
+
+	if (pandora->attach_tids)
+		hashtable_destroy(pandora->attach_tids);
+
 	pink_easy_context_destroy(pandora->ctx);
 
 	free(pandora);
 	pandora = NULL;
 
 	systable_free();
+	dcache_free();
+	prefix_free();
+	verdict_free();
+	patset_free();
+	intern_free();
+#if PANDORA_HAVE_SECCOMP
+	seccomp_filter_free(filter);
+	filter = NULL;
+#endif
 	log_close();
 }
 
@@ -207,56 +235,187 @@ sig_user(int signo)
 			cmpl ? "complete " : "");
 	c = pink_easy_process_list_walk(list, dump_one_process, UINT_TO_PTR(cmpl));
 	fprintf(stderr, "Tracing %u process%s\n", c, c > 1 ? "es" : "");
+	stats_dump(stderr);
+}
+
+#if PANDORA_HAVE_SECCOMP
+static void
+pandora_seccomp_init(void)
+{
+	int r;
+	unsigned count;
+	long *list;
+
+	if (!seccomp_available()) {
+		warning("kernel doesn't support seccomp filters, disabling core/trace/use_seccomp");
+		pandora->config.use_seccomp = false;
+		return;
+	}
+	pandora->seccomp_entry_stop = seccomp_entry_stop_follows();
+
+	if (!(filter = seccomp_filter_new()))
+		die_errno(-1, "seccomp_filter_new");
+
+#if PINKTRACE_BITNESS_64_SUPPORTED && defined(SECCOMP_ARCH_64)
+	count = systable_list(PINK_BITNESS_64, &list);
+	if ((r = seccomp_filter_add_arch(filter, SECCOMP_ARCH_64, list, count)) < 0) {
+		errno = -r;
+		die_errno(-1, "seccomp_filter_add_arch");
+	}
+	free(list);
+#endif
+#if PINKTRACE_BITNESS_32_SUPPORTED && defined(SECCOMP_ARCH_32)
+	count = systable_list(PINK_BITNESS_32, &list);
+	if ((r = seccomp_filter_add_arch(filter, SECCOMP_ARCH_32, list, count)) < 0) {
+		errno = -r;
+		die_errno(-1, "seccomp_filter_add_arch");
+	}
+	free(list);
+#endif
+
+	info("generated seccomp filter with %u instructions", seccomp_filter_length(filter));
 }
 
+/*
+ * Runs in the child after it has stopped for the tracer, installs the seccomp
+ * filter and executes the command.
+ */
+static int
+pandora_seccomp_child(void *userdata)
+{
+	int r;
+	char **argv = userdata;
+
+	if ((r = seccomp_filter_apply(filter)) < 0) {
+		fprintf(stderr, PACKAGE": failed to apply seccomp filter (errno:%d %s)\n",
+				-r, strerror(-r));
+		return 127;
+	}
+
+	execvp(argv[0], argv);
+	fprintf(stderr, PACKAGE": execvp(\"%s\") failed (errno:%d %s)\n",
+			argv[0], errno, strerror(errno));
+	return 127;
+}
+#endif
+
+/* Write the statistics to core/log/stats_file */
+static void
+pandora_write_stats(void)
+{
+	int r;
+	const char *path = pandora->config.stats_file;
+
+	if (!path)
+		return;
+
+	if ((r = stats_write_json(path)) < 0)
+		warning("failed to write statistics to `%s' (errno:%d %s)",
+				path, -r, strerror(-r));
+	else
+		info("wrote statistics to `%s'", path);
+}
+
+static bool
+pandora_attach_one(pid_t tid, pid_t pid)
+{
+	if (pink_easy_attach(pandora->ctx, tid, tid != pid ? pid : -1) < 0) {
+		if (errno == ESRCH) {
+			/* Thread exited in the meantime */
+			debug("tid:%lu of process:%lu exited before attach",
+					(unsigned long)tid, (unsigned long)pid);
+			return false;
+		}
+		warning("failed to attach to tid:%lu (errno:%d %s)",
+				(unsigned long)tid,
+				errno, strerror(errno));
+		return false;
+	}
+	return true;
+}
+
+/*
+ * Attach to all threads of the process.
+ * Threads may be created while we attach, so /proc/$pid/task is read again
+ * until a pass finds no new threads. New threads of the ones we've already
+ * attached to are traced via clone events so the list eventually settles.
+ *
+ * The threads are kept in pandora->attach_tids, callback_birth() reports the
+ * attach latency when the attach stop of the last one comes.
+ */
 static unsigned
 pandora_attach_all(pid_t pid)
 {
+	int r;
 	char *ptask;
 	DIR *dir;
+	bool found;
+	unsigned ntid, npass;
+	pid_t tid;
+	struct dirent *de;
+	ht_int32_node_t *node;
+
+	if (!pandora->attach_tids && (r = hashtable_create(64, 0, &pandora->attach_tids)) < 0) {
+		errno = -r;
+		die_errno(-1, "hashtable_create");
+	}
 
 	if (!pandora->config.follow_fork)
 		goto one;
 
-	/* Read /proc/$pid/task and attach to all threads */
 	xasprintf(&ptask, "/proc/%lu/task", (unsigned long)pid);
-	dir = opendir(ptask);
-	free(ptask);
 
-	if (dir) {
-		unsigned ntid = 0, nerr = 0;
-		struct dirent *de;
-		pid_t tid;
+	ntid = npass = 0;
+	do {
+		found = false;
+		if (!(dir = opendir(ptask))) {
+			if (npass)
+				break;
+			warning("failed to open %s (errno:%d %s)",
+					ptask, errno, strerror(errno));
+			free(ptask);
+			goto one;
+		}
+		++npass;
 
 		while ((de = readdir(dir))) {
 			if (de->d_fileno == 0)
 				continue;
 			if (parse_pid(de->d_name, &tid) < 0)
 				continue;
-			++ntid;
-			if (pink_easy_attach(pandora->ctx, tid, tid != pid ? pid : -1) < 0) {
-				warning("failed to attach to tid:%lu (errno:%d %s)",
-						(unsigned long)tid,
-						errno, strerror(errno));
-				++nerr;
-			}
 
+			if (!(node = hashtable_find(pandora->attach_tids, tid, 1)))
+				die_errno(-1, "hashtable_find");
+			if (node->data)
+				continue; /* seen in an earlier pass */
+			node->data = UINT_TO_PTR(1);
+			found = true;
+
+			if (pandora_attach_one(tid, pid)) {
+				++ntid;
+				++pandora->attach_pending;
+			}
+			else
+				node->data = UINT_TO_PTR(2);
 		}
 		closedir(dir);
-		ntid -= nerr;
-		return ntid;
-	}
+	} while (found);
+
+	free(ptask);
 
-	warning("failed to open /proc/%lu/task (errno:%d %s)",
+	info("attached to %u thread%s of process:%lu (%u pass%s over the task list)",
+			ntid, ntid > 1 ? "s" : "",
 			(unsigned long)pid,
-			errno, strerror(errno));
+			npass, npass > 1 ? "es" : "");
+	return ntid;
+
 one:
-	if (pink_easy_attach(pandora->ctx, pid, -1) < 0) {
-		warning("failed to attach process:%lu (errno:%d %s)",
-				(unsigned long)pid,
-				errno, strerror(errno));
+	if (!pandora_attach_one(pid, pid))
 		return 0;
-	}
+	if (!(node = hashtable_find(pandora->attach_tids, pid, 1)))
+		die_errno(-1, "hashtable_find");
+	node->data = UINT_TO_PTR(1);
+	++pandora->attach_pending;
 	return 1;
 }
 
@@ -329,14 +488,29 @@ main(int argc, char **argv)
 	/* Configuration is done */
 	config_destroy();
 
+	/* The filter must be installed before the first execve(), there is no
+	 * way to add it to processes which are already running. */
+	if (pid_count && pandora->config.use_seccomp) {
+		warning("core/trace/use_seccomp has no effect when attaching to processes");
+		pandora->config.use_seccomp = false;
+	}
+
 	/* Initialize callbacks */
 	callback_init();
 	systable_init();
 	sysinit();
+#if PANDORA_HAVE_SECCOMP
+	if (pandora->config.use_seccomp)
+		pandora_seccomp_init();
+#endif
 
 	ptrace_options = PINK_TRACE_OPTION_SYSGOOD | PINK_TRACE_OPTION_EXEC | PINK_TRACE_OPTION_EXIT;
 	if (pandora->config.follow_fork)
 		ptrace_options |= (PINK_TRACE_OPTION_FORK | PINK_TRACE_OPTION_VFORK | PINK_TRACE_OPTION_CLONE);
+#if PANDORA_HAVE_SECCOMP
+	if (pandora->config.use_seccomp)
+		ptrace_options |= PINK_TRACE_OPTION_SECCOMP;
+#endif
 
 	if (!(pandora->ctx = pink_easy_context_new(ptrace_options, &pandora->callback_table, NULL, NULL)))
 		die_errno(-1, "pink_easy_context_new");
@@ -344,11 +518,21 @@ main(int argc, char **argv)
 	if (!pid_count) {
 		free(pid_list);
 
+#if PANDORA_HAVE_SECCOMP
+		if (pandora->config.use_seccomp) {
+			if (pink_easy_call(pandora->ctx, pandora_seccomp_child, &argv[optind]))
+				die(1, "failed to execute child process");
+		}
+		else
+#endif
 		if (pink_easy_execvp(pandora->ctx, argv[optind], &argv[optind]))
 			die(1, "failed to execute child process");
 	}
 	else {
 		unsigned npid = 0;
+		/* The parents of the processes aren't traced */
+		pandora->untraced = true;
+		pandora->attach_start = stats_now();
 		for (unsigned i = 0; i < pid_count; i++)
 			npid += pandora_attach_all(pid_list[i]);
 		if (!npid)
@@ -382,6 +566,24 @@ main(int argc, char **argv)
 	sigaction(SIGCHLD, &sa, NULL);
 
 	ret = pink_easy_loop(pandora->ctx);
+	info("handled %llu system call entries and %llu exit stops, skipped %llu exit stops",
+			pandora->stats.sys_enter,
+			pandora->stats.sys_exit,
+			pandora->stats.sys_exit_skip);
+	info("traced %llu processes, at most %lu at once",
+			pandora->stats.proc_birth,
+			pandora->stats.proc_alive_max);
+	info("decoded %llu paths, read tracee memory with %llu system calls instead of %llu",
+			pandora->stats.mem_paths,
+			pandora->stats.mem_syscalls,
+			pandora->stats.mem_peeks);
+	info("resolved %llu paths from the cache, %llu from the file system",
+			pandora->stats.resolve_hit,
+			pandora->stats.resolve_miss);
+	info("looked up %llu path components from the cache, %llu from the file system",
+			pandora->stats.dcache_hit,
+			pandora->stats.dcache_miss);
+	pandora_write_stats();
 	pandora_destroy();
 	return ret;
 }
@@ -0,0 +1,247 @@
+/* vim: set cino= fo=croql sw=8 ts=8 sts=0 noet cin fdm=syntax : */
+
+/*
+ * Copyright (c) 2011 Ali Polatel <alip@exherbo.org>
+ *
+ * This file is part of Pandora's Box. pandora is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * pandora is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <assert.h>
+#include <errno.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/prctl.h>
+#include <sys/utsname.h>
+
+#include <linux/audit.h>
+#include <linux/filter.h>
+#include <linux/seccomp.h>
+
+#include "seccomp.h"
+
+#ifndef PR_SET_NO_NEW_PRIVS
+#define PR_SET_NO_NEW_PRIVS 38
+#endif
+
+#ifndef __X32_SYSCALL_BIT
+#define __X32_SYSCALL_BIT 0x40000000
+#endif
+
+/*
+ * The filter has the following layout:
+ *
+ *	load arch
+ *	for each architecture:
+ *		if arch != this one, jump over the block
+ *		load syscall number
+ *		for each syscall: if nr == syscall, return TRACE
+ *		return ALLOW
+ *	return TRACE
+ *
+ * Each comparison is followed by its own return statement so no conditional
+ * jump ever needs an offset larger than one, and the architecture blocks are
+ * skipped using BPF_JA which takes a 32 bit offset. System calls of unknown
+ * architectures are always traced.
+ */
+struct seccomp_filter {
+	unsigned len;
+	unsigned size;
+	struct sock_filter *insns;
+};
+
+static int
+seccomp_filter_grow(seccomp_filter_t *filter, unsigned count)
+{
+	unsigned size;
+	struct sock_filter *insns;
+
+	if (filter->len + count <= filter->size)
+		return 0;
+
+	size = filter->size ? filter->size : 64;
+	while (size < filter->len + count)
+		size *= 2;
+
+	if (!(insns = realloc(filter->insns, size * sizeof(struct sock_filter))))
+		return -errno;
+
+	filter->insns = insns;
+	filter->size = size;
+	return 0;
+}
+
+static void
+seccomp_filter_push(seccomp_filter_t *filter, uint16_t code, uint8_t jt, uint8_t jf, uint32_t k)
+{
+	struct sock_filter *insn;
+
+	assert(filter->len < filter->size);
+
+	insn = &filter->insns[filter->len++];
+	insn->code = code;
+	insn->jt = jt;
+	insn->jf = jf;
+	insn->k = k;
+}
+
+/*
+ * Check whether the running kernel supports seccomp filters.
+ * Passing a NULL program results in EFAULT if filters are supported and EINVAL
+ * otherwise.
+ */
+bool
+seccomp_available(void)
+{
+	if (prctl(PR_SET_SECCOMP, SECCOMP_MODE_FILTER, NULL, 0, 0) < 0)
+		return errno == EFAULT;
+	return true; /* not reached */
+}
+
+/*
+ * Check whether the system call entry stop comes after the seccomp stop.
+ * Linux 4.8 moved the seccomp check after the entry stop, until then a tracer
+ * resuming from the seccomp stop with PTRACE_SYSCALL stops at the entry of the
+ * system call before its exit.
+ */
+bool
+seccomp_entry_stop_follows(void)
+{
+	int major, minor;
+	struct utsname buf;
+
+	if (uname(&buf) < 0 || sscanf(buf.release, "%d.%d", &major, &minor) != 2)
+		return false;
+	return major < 4 || (major == 4 && minor < 8);
+}
+
+seccomp_filter_t *
+seccomp_filter_new(void)
+{
+	seccomp_filter_t *filter;
+
+	if (!(filter = calloc(1, sizeof(seccomp_filter_t))))
+		return NULL;
+
+	if (seccomp_filter_grow(filter, 2) < 0) {
+		free(filter);
+		return NULL;
+	}
+
+	seccomp_filter_push(filter, BPF_LD|BPF_W|BPF_ABS, 0, 0,
+			offsetof(struct seccomp_data, arch));
+	seccomp_filter_push(filter, BPF_RET|BPF_K, 0, 0, SECCOMP_RET_TRACE);
+	return filter;
+}
+
+void
+seccomp_filter_free(seccomp_filter_t *filter)
+{
+	if (!filter)
+		return;
+	free(filter->insns);
+	free(filter);
+}
+
+/*
+ * Add a block for the given audit architecture which traces the listed system
+ * call numbers and allows everything else.
+ */
+int
+seccomp_filter_add_arch(seccomp_filter_t *filter, uint32_t arch, const long *syscalls, unsigned count)
+{
+	int r;
+	bool x32;
+	unsigned blen;
+	struct sock_filter last;
+
+	assert(filter);
+	assert(filter->len >= 2);
+
+#ifdef AUDIT_ARCH_X86_64
+	/* x32 system calls share the x86_64 audit architecture, pinktrace
+	 * can't decode them so keep tracing them as we used to. */
+	x32 = (arch == AUDIT_ARCH_X86_64);
+#else
+	x32 = false;
+#endif
+
+	/* load nr + x32 check + (jeq + ret) per syscall + ret allow */
+	blen = 1 + (x32 ? 2 : 0) + 2 * count + 1;
+	if ((r = seccomp_filter_grow(filter, 2 + blen)) < 0)
+		return r;
+
+	/* Insert the block before the final return statement */
+	last = filter->insns[--filter->len];
+
+	seccomp_filter_push(filter, BPF_JMP|BPF_JEQ|BPF_K, 1, 0, arch);
+	seccomp_filter_push(filter, BPF_JMP|BPF_JA, 0, 0, blen);
+
+	seccomp_filter_push(filter, BPF_LD|BPF_W|BPF_ABS, 0, 0,
+			offsetof(struct seccomp_data, nr));
+	if (x32) {
+		seccomp_filter_push(filter, BPF_JMP|BPF_JGE|BPF_K, 0, 1, __X32_SYSCALL_BIT);
+		seccomp_filter_push(filter, BPF_RET|BPF_K, 0, 0, SECCOMP_RET_TRACE);
+	}
+	for (unsigned i = 0; i < count; i++) {
+		seccomp_filter_push(filter, BPF_JMP|BPF_JEQ|BPF_K, 0, 1, (uint32_t)syscalls[i]);
+		seccomp_filter_push(filter, BPF_RET|BPF_K, 0, 0, SECCOMP_RET_TRACE);
+	}
+	seccomp_filter_push(filter, BPF_RET|BPF_K, 0, 0, SECCOMP_RET_ALLOW);
+
+	filter->insns[filter->len++] = last;
+	return 0;
+}
+
+unsigned
+seccomp_filter_length(const seccomp_filter_t *filter)
+{
+	return filter->len;
+}
+
+/*
+ * Install the filter in the calling process.
+ * Without CAP_SYS_ADMIN the kernel refuses filters unless no_new_privs is set,
+ * which we only do when we have to since it breaks set-id executables.
+ */
+int
+seccomp_filter_apply(const seccomp_filter_t *filter)
+{
+	struct sock_fprog prog;
+
+	assert(filter);
+
+	if (filter->len > BPF_MAXINSNS)
+		return -E2BIG;
+
+	memset(&prog, 0, sizeof(struct sock_fprog));
+	prog.len = filter->len;
+	prog.filter = filter->insns;
+
+	if (!prctl(PR_SET_SECCOMP, SECCOMP_MODE_FILTER, &prog, 0, 0))
+		return 0;
+	if (errno != EACCES)
+		return -errno;
+
+	if (prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0) < 0)
+		return -errno;
+	if (prctl(PR_SET_SECCOMP, SECCOMP_MODE_FILTER, &prog, 0, 0) < 0)
+		return -errno;
+	return 0;
+}
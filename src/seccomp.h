@@ -0,0 +1,55 @@
+/* vim: set cino= fo=croql sw=8 ts=8 sts=0 noet cin fdm=syntax : */
+
+/*
+ * Copyright (c) 2011 Ali Polatel <alip@exherbo.org>
+ *
+ * This file is part of Pandora's Box. pandora is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * pandora is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef SECCOMP_H
+#define SECCOMP_H 1
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <linux/audit.h>
+
+/* Audit architecture values of the personalities we may trace */
+#if defined(__x86_64__)
+#define SECCOMP_ARCH_64	AUDIT_ARCH_X86_64
+#define SECCOMP_ARCH_32	AUDIT_ARCH_I386
+#elif defined(__i386__)
+#define SECCOMP_ARCH_32	AUDIT_ARCH_I386
+#elif defined(__powerpc64__)
+#define SECCOMP_ARCH_64	AUDIT_ARCH_PPC64
+#define SECCOMP_ARCH_32	AUDIT_ARCH_PPC
+#elif defined(__powerpc__)
+#define SECCOMP_ARCH_32	AUDIT_ARCH_PPC
+#elif defined(__ia64__)
+#define SECCOMP_ARCH_64	AUDIT_ARCH_IA64
+#elif defined(__arm__)
+#define SECCOMP_ARCH_32	AUDIT_ARCH_ARM
+#endif
+
+typedef struct seccomp_filter seccomp_filter_t;
+
+bool seccomp_available(void);
+bool seccomp_entry_stop_follows(void);
+seccomp_filter_t *seccomp_filter_new(void);
+void seccomp_filter_free(seccomp_filter_t *filter);
+int seccomp_filter_add_arch(seccomp_filter_t *filter, uint32_t arch,
+		const long *syscalls, unsigned count);
+unsigned seccomp_filter_length(const seccomp_filter_t *filter);
+int seccomp_filter_apply(const seccomp_filter_t *filter);
+
+#endif /* !SECCOMP_H */
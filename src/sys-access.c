@@ -35,8 +35,6 @@ sys_access(pink_easy_process_t *current, const char *name)
 {
 	int r;
 	long mode;
-	pid_t pid = pink_easy_process_get_pid(current);
-	pink_bitness_t bit = pink_easy_process_get_bitness(current);
 	proc_data_t *data = pink_easy_process_get_userdata(current);
 	sys_info_t info;
 
@@ -46,15 +44,7 @@ sys_access(pink_easy_process_t *current, const char *name)
 		return 0;
 
 
-	if (!pink_util_get_arg(pid, bit, 1, &mode)) {
-		if (errno != ESRCH) {
-			warning("pink_util_get_arg(%lu, \"%s\", 1) failed (errno:%d %s)",
-					(unsigned long)pid, pink_bitness_name(bit),
-					errno, strerror(errno));
-			return panic(current);
-		}
-		return PINK_EASY_CFLAG_DROP;
-	}
+	mode = data->args[1];
 
 	if (!((mode & R_OK) && data->config.sandbox_read == SANDBOX_OFF)
 		&& !((mode & W_OK) && data->config.sandbox_write == SANDBOX_OFF)
@@ -94,8 +84,6 @@ sys_faccessat(pink_easy_process_t *current, const char *name)
 {
 	int r;
 	long mode, flags;
-	pid_t pid = pink_easy_process_get_pid(current);
-	pink_bitness_t bit = pink_easy_process_get_bitness(current);
 	proc_data_t *data = pink_easy_process_get_userdata(current);
 	sys_info_t info;
 
@@ -105,16 +93,7 @@ sys_faccessat(pink_easy_process_t *current, const char *name)
 		return 0;
 
 	/* Check mode argument first */
-	if (!pink_util_get_arg(pid, bit, 2, &mode)) {
-		if (errno != ESRCH) {
-			warning("pink_util_get_arg(%lu, \"%s\", 2): %d(%s)",
-					(unsigned long)pid,
-					pink_bitness_name(bit),
-					errno, strerror(errno));
-			return panic(current);
-		}
-		return PINK_EASY_CFLAG_DROP;
-	}
+	mode = data->args[2];
 
 	if (!((mode & R_OK) && data->config.sandbox_read == SANDBOX_OFF)
 		&& !((mode & W_OK) && data->config.sandbox_write == SANDBOX_OFF)
@@ -122,16 +101,7 @@ sys_faccessat(pink_easy_process_t *current, const char *name)
 		return 0;
 
 	/* Check for AT_SYMLINK_NOFOLLOW */
-	if (!pink_util_get_arg(pid, bit, 3, &flags)) {
-		if (errno != ESRCH) {
-			warning("pink_util_get_arg(%lu, \"%s\", 3): %d(%s)",
-					(unsigned long)pid,
-					pink_bitness_name(bit),
-					errno, strerror(errno));
-			return panic(current);
-		}
-		return PINK_EASY_CFLAG_DROP;
-	}
+	flags = data->args[3];
 
 	memset(&info, 0, sizeof(sys_info_t));
 	info.at     = true;
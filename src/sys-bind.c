@@ -40,7 +40,7 @@ sys_bind(pink_easy_process_t *current, const char *name)
 {
 	int r;
 	long fd;
-	char *unix_abspath;
+	const char *unix_abspath;
 	pink_socket_address_t *psa;
 	sys_info_t info;
 	pid_t pid = pink_easy_process_get_pid(current);
@@ -68,9 +68,11 @@ sys_bind(pink_easy_process_t *current, const char *name)
 
 	if (pandora->config.whitelist_successful_bind && !r) {
 		/* Decode the file descriptor, for use in exit */
-		if (!pink_util_get_arg(pid, bit, 0, &fd)) {
+		if (!data->subcall)
+			fd = data->args[0];
+		else if (!pink_decode_socket_fd(pid, bit, 0, &fd)) {
 			if (errno != ESRCH) {
-				warning("pink_util_get_arg(%lu, \"%s\", 0) failed (errno:%d %s)",
+				warning("pink_decode_socket_fd(%lu, \"%s\", 0) failed (errno:%d %s)",
 						(unsigned long)pid,
 						pink_bitness_name(bit),
 						errno, strerror(errno));
@@ -78,7 +80,7 @@ sys_bind(pink_easy_process_t *current, const char *name)
 			}
 			return PINK_EASY_CFLAG_DROP;
 		}
-		data->args[0] = fd;
+		data->fd = fd;
 
 		switch (psa->family) {
 		case AF_UNIX:
@@ -96,8 +98,7 @@ sys_bind(pink_easy_process_t *current, const char *name)
 	}
 
 	if (pandora->config.whitelist_successful_bind) {
-		if (unix_abspath)
-			free(unix_abspath);
+		intern_release(unix_abspath);
 		if (psa)
 			free(psa);
 	}
@@ -153,7 +154,7 @@ sysx_bind(pink_easy_process_t *current, const char *name)
 	SLIST_INSERT_HEAD(&data->config.whitelist_sock_connect, snode, up);
 	return 0;
 zero:
-	node = hashtable_find(data->sockmap, data->args[0] + 1, 1);
+	node = hashtable_find(data->sockmap, data->fd + 1, 1);
 	if (!node)
 		die_errno(-1, "hashtable_find");
 	node->data = data->savebind;
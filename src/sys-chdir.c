@@ -20,7 +20,10 @@
 #include "pandora-defs.h"
 
 #include <sys/types.h>
+#include <sys/stat.h>
 #include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -30,12 +33,84 @@
 #include "proc.h"
 #include "util.h"
 
+/*
+ * Figure out the new working directory of a chdir() or fchdir() call at its
+ * entry without reading /proc/$pid/cwd: the argument of chdir() is resolved
+ * against the old working directory, the file descriptor of fchdir() is looked
+ * up in the file descriptor table, see pandora-fd.c.
+ * Returns 0 and stores the path in buf on success, negated errno otherwise.
+ */
+static int
+chdir_path(pink_easy_process_t *current, const char *name, const char **buf)
+{
+	int r;
+	long fd;
+	char *path;
+	resolve_result_t res;
+	pid_t pid = pink_easy_process_get_pid(current);
+	proc_data_t *data = pink_easy_process_get_userdata(current);
+
+	if (streq(name, "fchdir")) {
+		if (!pandora->config.track_fds)
+			return -EOPNOTSUPP;
+		/* Arguments of the 32 bit personality are zero extended */
+		fd = (int)data->args[0];
+		return fdtable_lookup(data, fd, buf);
+	}
+
+	if (!mem_decode_string(pid, data, 0, &path))
+		return -errno;
+	if (!path)
+		return -EFAULT;
+	if ((r = box_resolve_path(path, data->cwd, pid, data, 0, 1, &res)) < 0)
+		return r;
+	*buf = res.path;
+	return 0;
+}
+
+/*
+ * Check the path figured out at the entry against /proc/$pid/cwd.
+ * Another thread may change the argument of chdir() after it is read, or the
+ * directory may be renamed, before the kernel looks it up.
+ */
+static bool
+chdir_verify(pid_t pid, const char *path)
+{
+	char proc[sizeof("/proc//cwd") + sizeof(long) * 3];
+	struct stat st, procst;
+
+	snprintf(proc, sizeof(proc), "/proc/%lu/cwd", (unsigned long)pid);
+	if (stat(path, &st) < 0 || stat(proc, &procst) < 0)
+		return false;
+	return st.st_dev == procst.st_dev && st.st_ino == procst.st_ino;
+}
+
 int
-sysx_chdir(pink_easy_process_t *current, PINK_GCC_ATTR((unused)) const char *name)
+sys_chdir(pink_easy_process_t *current, const char *name)
+{
+	int r;
+	const char *path;
+	pid_t pid = pink_easy_process_get_pid(current);
+	proc_data_t *data = pink_easy_process_get_userdata(current);
+
+	if ((r = chdir_path(current, name, &path)) < 0) {
+		debug("failed to figure out the directory of %s() call of process:%lu (errno:%d %s)",
+				name, (unsigned long)pid,
+				-r, strerror(-r));
+		return 0;
+	}
+
+	data->chdir_path = intern(path);
+	return 0;
+}
+
+int
+sysx_chdir(pink_easy_process_t *current, const char *name)
 {
 	int r;
 	long ret;
-	char *cwd;
+	char *procpath;
+	const char *cwd;
 	pid_t pid = pink_easy_process_get_pid(current);
 	pink_bitness_t bit = pink_easy_process_get_bitness(current);
 	proc_data_t *data = pink_easy_process_get_userdata(current);
@@ -55,20 +130,31 @@ sysx_chdir(pink_easy_process_t *current, PINK_GCC_ATTR((unused)) const char *nam
 		return 0;
 	}
 
-	if ((r = proc_cwd(pid, &cwd)) < 0) {
-		warning("proc_cwd(%lu): %d(%s)",
-				(unsigned long)pid,
-				-r, strerror(-r));
-		return panic(current);
+	if (data->chdir_path && chdir_verify(pid, data->chdir_path))
+		cwd = intern_ref(data->chdir_path);
+	else {
+		if (data->chdir_path)
+			debug("directory \"%s\" of %s() call doesn't match /proc/%lu/cwd",
+					data->chdir_path, name, (unsigned long)pid);
+		if ((r = proc_cwd(pid, &procpath)) < 0) {
+			warning("proc_cwd(%lu): %d(%s)",
+					(unsigned long)pid,
+					-r, strerror(-r));
+			return panic(current);
+		}
+		if (pandora->config.track_fds && streq(name, "fchdir"))
+			fdtable_learn(pid, data, (int)data->args[0], procpath);
+		cwd = intern(procpath);
+		free(procpath);
 	}
 
-	if (!streq(data->cwd, cwd))
+	if (cwd != data->cwd)
 		info("process:%lu [%s name:\"%s\" cwd:\"%s\"] changed directory to \"%s\"",
 				(unsigned long)pid,
 				pink_bitness_name(bit),
 				data->comm, data->cwd, cwd);
 
-	free(data->cwd);
+	intern_release(data->cwd);
 	data->cwd = cwd;
 	return 0;
 }
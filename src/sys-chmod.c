@@ -48,8 +48,6 @@ int
 sys_fchmodat(pink_easy_process_t *current, const char *name)
 {
 	long flags;
-	pid_t pid = pink_easy_process_get_pid(current);
-	pink_bitness_t bit = pink_easy_process_get_bitness(current);
 	proc_data_t *data = pink_easy_process_get_userdata(current);
 	sys_info_t info;
 
@@ -57,16 +55,7 @@ sys_fchmodat(pink_easy_process_t *current, const char *name)
 		return 0;
 
 	/* Check for AT_SYMLINK_NOFOLLOW */
-	if (!pink_util_get_arg(pid, bit, 3, &flags)) {
-		if (errno != ESRCH) {
-			warning("pink_util_get_arg(%lu, \"%s\", 3): %d(%s)",
-					(unsigned long)pid,
-					pink_bitness_name(bit),
-					errno, strerror(errno));
-			return panic(current);
-		}
-		return PINK_EASY_CFLAG_DROP;
-	}
+	flags = data->args[3];
 
 	memset(&info, 0, sizeof(sys_info_t));
 	info.at     = true;
@@ -63,8 +63,6 @@ int
 sys_fchownat(pink_easy_process_t *current, const char *name)
 {
 	long flags;
-	pid_t pid = pink_easy_process_get_pid(current);
-	pink_bitness_t bit = pink_easy_process_get_bitness(current);
 	proc_data_t *data = pink_easy_process_get_userdata(current);
 	sys_info_t info;
 
@@ -72,16 +70,7 @@ sys_fchownat(pink_easy_process_t *current, const char *name)
 		return 0;
 
 	/* Check for AT_SYMLINK_FOLLOW */
-	if (!pink_util_get_arg(pid, bit, 4, &flags)) {
-		if (errno != ESRCH) {
-			warning("pink_util_get_arg(%lu, \"%s\", 4): %d(%s)",
-					(unsigned long)pid,
-					pink_bitness_name(bit),
-					errno, strerror(errno));
-			return panic(current);
-		}
-		return PINK_EASY_CFLAG_DROP;
-	}
+	flags = data->args[4];
 
 	memset(&info, 0, sizeof(sys_info_t));
 	info.at     = true;
@@ -32,27 +32,28 @@
 int
 sys_close(pink_easy_process_t *current, PINK_GCC_ATTR((unused)) const char *name)
 {
-	long fd;
-	pid_t pid = pink_easy_process_get_pid(current);
-	pink_bitness_t bit = pink_easy_process_get_bitness(current);
 	proc_data_t *data = pink_easy_process_get_userdata(current);
 
+	/* The descriptor is released even if close() fails with EINTR */
+	if (pandora->config.track_fds)
+		fdtable_close(data, data->args[0], data->args[0]);
+
 	if (data->config.sandbox_sock == SANDBOX_OFF || !pandora->config.whitelist_successful_bind)
 		return 0;
 
-	if (!pink_util_get_arg(pid, bit, 0, &fd)) {
-		if (errno != ESRCH) {
-			warning("pink_util_get_arg(%lu, \"%s\", 0) failed (errno:%d %s)",
-					(unsigned long)pid,
-					pink_bitness_name(bit),
-					errno, strerror(errno));
-			return panic(current);
-		}
-		return PINK_EASY_CFLAG_DROP;
-	}
+	if (hashtable_find(data->sockmap, data->args[0] + 1, 0))
+		data->fd = data->args[0];
+
+	return 0;
+}
+
+int
+sys_close_range(pink_easy_process_t *current, PINK_GCC_ATTR((unused)) const char *name)
+{
+	proc_data_t *data = pink_easy_process_get_userdata(current);
 
-	if (hashtable_find(data->sockmap, fd + 1, 0))
-		data->args[0] = fd;
+	if (pandora->config.track_fds)
+		fdtable_close(data, (unsigned int)data->args[0], (unsigned int)data->args[1]);
 
 	return 0;
 }
@@ -66,7 +67,7 @@ sysx_close(pink_easy_process_t *current, PINK_GCC_ATTR((unused)) const char *nam
 	pink_bitness_t bit = pink_easy_process_get_bitness(current);
 	proc_data_t *data = pink_easy_process_get_userdata(current);
 
-	if (data->config.sandbox_sock == SANDBOX_OFF || !pandora->config.whitelist_successful_bind || !data->args[0])
+	if (data->config.sandbox_sock == SANDBOX_OFF || !pandora->config.whitelist_successful_bind || data->fd < 0)
 		return 0;
 
 	if (!pink_util_get_return(pid, &ret)) {
@@ -86,7 +87,7 @@ sysx_close(pink_easy_process_t *current, PINK_GCC_ATTR((unused)) const char *nam
 		return 0;
 	}
 
-	node = hashtable_find(data->sockmap, data->args[0] + 1, 0);
+	node = hashtable_find(data->sockmap, data->fd + 1, 0);
 	assert(node);
 
 	node->key = 0;
@@ -94,6 +95,6 @@ sysx_close(pink_easy_process_t *current, PINK_GCC_ATTR((unused)) const char *nam
 	node->data = NULL;
 	info("process:%lu [%s name:\"%s\" cwd:\"%s\"] closed fd:%lu by %s() call",
 			(unsigned long)pid, pink_bitness_name(bit),
-			data->comm, data->cwd, data->args[0], name);
+			data->comm, data->cwd, data->fd, name);
 	return 0;
 }
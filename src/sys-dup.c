@@ -30,26 +30,13 @@
 int
 sys_dup(pink_easy_process_t *current, PINK_GCC_ATTR((unused)) const char *name)
 {
-	long fd;
-	pid_t pid = pink_easy_process_get_pid(current);
-	pink_bitness_t bit = pink_easy_process_get_bitness(current);
 	proc_data_t *data = pink_easy_process_get_userdata(current);
 
-	if (data->config.sandbox_sock == SANDBOX_OFF || !pandora->config.whitelist_successful_bind)
+	if (!pandora->config.track_fds
+			&& (data->config.sandbox_sock == SANDBOX_OFF || !pandora->config.whitelist_successful_bind))
 		return 0;
 
-	if (!pink_util_get_arg(pid, bit, 0, &fd)) {
-		if (errno != ESRCH) {
-			warning("pink_util_get_arg(%lu, \"%s\", 0): %d(%s)",
-					(unsigned long)pid,
-					pink_bitness_name(bit),
-					errno, strerror(errno));
-			return panic(current);
-		}
-		return PINK_EASY_CFLAG_DROP;
-	}
-
-	data->args[0] = fd;
+	data->fd = data->args[0];
 	return 0;
 }
 
@@ -62,7 +49,7 @@ sysx_dup(pink_easy_process_t *current, const char *name)
 	pink_bitness_t bit = pink_easy_process_get_bitness(current);
 	proc_data_t *data = pink_easy_process_get_userdata(current);
 
-	if (data->config.sandbox_sock == SANDBOX_OFF || !pandora->config.whitelist_successful_bind || !data->args[0])
+	if (data->fd < 0)
 		return 0;
 
 	/* Check the return value */
@@ -83,10 +70,16 @@ sysx_dup(pink_easy_process_t *current, const char *name)
 		return 0;
 	}
 
-	if (!(old_node = hashtable_find(data->sockmap, data->args[0] + 1, 0))) {
+	if (pandora->config.track_fds)
+		fdtable_dup(data, data->fd, ret);
+
+	if (data->config.sandbox_sock == SANDBOX_OFF || !pandora->config.whitelist_successful_bind)
+		return 0;
+
+	if (!(old_node = hashtable_find(data->sockmap, data->fd + 1, 0))) {
 		debug("process:%lu [%s name:\"%s\" cwd:\"%s\"] duplicated unknown fd:%ld to fd:%ld by %s() call",
 				(unsigned long)pid, pink_bitness_name(bit),
-				data->comm, data->cwd, data->args[0], ret, name);
+				data->comm, data->cwd, data->fd, ret, name);
 		return 0;
 	}
 
@@ -96,6 +89,6 @@ sysx_dup(pink_easy_process_t *current, const char *name)
 	new_node->data = sock_info_xdup(old_node->data);
 	info("process:%lu [%s name:\"%s\" cwd:\"%s\"] duplicated fd:%lu to fd:%lu by %s() call",
 			(unsigned long)pid, pink_bitness_name(bit),
-			data->comm, data->cwd, data->args[0], ret, name);
+			data->comm, data->cwd, data->fd, ret, name);
 	return 0;
 }
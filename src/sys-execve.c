@@ -20,6 +20,7 @@
 #include "pandora-defs.h"
 
 #include <errno.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include <pinktrace/pink.h>
@@ -29,12 +30,15 @@ int
 sys_execve(pink_easy_process_t *current, const char *name)
 {
 	int r;
-	char *path, *abspath;
+	char *path;
+	const char *abspath;
+	resolve_result_t res;
 	pid_t pid = pink_easy_process_get_pid(current);
 	pink_bitness_t bit = pink_easy_process_get_bitness(current);
 	proc_data_t *data = pink_easy_process_get_userdata(current);
 
-	path = abspath = NULL;
+	path = NULL;
+	abspath = NULL;
 
 	r = path_decode(current, 0, &path);
 	if (r < 0)
@@ -42,7 +46,7 @@ sys_execve(pink_easy_process_t *current, const char *name)
 	else if (r /* > 0 */)
 		return r;
 
-	if ((r = box_resolve_path(path, data->cwd, pid, 0, 1, &abspath)) < 0) {
+	if ((r = box_resolve_path(path, data->cwd, pid, data, 0, 1, &res)) < 0) {
 		info("resolving path:\"%s\" [%s() index:0] failed for process:%lu [%s name:\"%s\" cwd:\"%s\"] (errno:%d %s)",
 				path, name,
 				(unsigned long)pid, pink_bitness_name(bit),
@@ -52,10 +56,9 @@ sys_execve(pink_easy_process_t *current, const char *name)
 		r = deny(current);
 		if (pandora->config.violation_raise_fail)
 			violation(current, "%s(\"%s\")", name, path);
-		free(path);
 		return r;
 	}
-	free(path);
+	abspath = res.path;
 
 	/* Handling exec.kill_if_match and exec.resume_if_match:
 	 *
@@ -64,17 +67,18 @@ sys_execve(pink_easy_process_t *current, const char *name)
 	 * successful, we'll check for kill_if_match and resume_if_match lists
 	 * and kill or resume the process as necessary.
 	 */
-	data->abspath = abspath;
+	intern_release(data->abspath);
+	data->abspath = intern(abspath);
 
 	switch (data->config.sandbox_exec) {
 	case SANDBOX_OFF:
 		return 0;
 	case SANDBOX_DENY:
-		if (box_match_path(abspath, &data->config.whitelist_exec, NULL))
+		if (verdict_match(&data->config, &data->config.whitelist_exec, abspath))
 			return 0;
 		break;
 	case SANDBOX_ALLOW:
-		if (!box_match_path(abspath, &data->config.blacklist_exec, NULL))
+		if (!verdict_match(&data->config, &data->config.blacklist_exec, abspath))
 			return 0;
 		break;
 	default:
@@ -87,7 +91,7 @@ sys_execve(pink_easy_process_t *current, const char *name)
 	if (!box_match_path(abspath, &pandora->config.filter_exec, NULL))
 		violation(current, "%s(\"%s\")", name, abspath);
 
-	free(abspath);
+	intern_release(data->abspath);
 	data->abspath = NULL;
 
 	return r;
@@ -30,25 +30,15 @@
 int
 sys_fcntl(pink_easy_process_t *current, PINK_GCC_ATTR((unused)) const char *name)
 {
-	long fd, cmd;
-	pid_t pid = pink_easy_process_get_pid(current);
-	pink_bitness_t bit = pink_easy_process_get_bitness(current);
+	long cmd;
 	proc_data_t *data = pink_easy_process_get_userdata(current);
 
-	if (data->config.sandbox_sock == SANDBOX_OFF || !pandora->config.whitelist_successful_bind)
+	if (!pandora->config.track_fds
+			&& (data->config.sandbox_sock == SANDBOX_OFF || !pandora->config.whitelist_successful_bind))
 		return 0;
 
 	/* Decode the command */
-	if (!pink_util_get_arg(pid, bit, 1, &cmd)) {
-		if (errno != ESRCH) {
-			warning("pink_util_get_arg(%lu, \"%s\", 1): %d(%s)",
-					(unsigned long)pid,
-					pink_bitness_name(bit),
-					errno, strerror(errno));
-			return panic(current);
-		}
-		return PINK_EASY_CFLAG_DROP;
-	}
+	cmd = data->args[1];
 
 	/* We're interested in two commands:
 	 * fcntl(fd, F_DUPFD);
@@ -59,25 +49,12 @@ sys_fcntl(pink_easy_process_t *current, PINK_GCC_ATTR((unused)) const char *name
 #ifdef F_DUPFD_CLOEXEC
 	case F_DUPFD_CLOEXEC:
 #endif /* F_DUPFD_CLOEXEC */
-		data->args[1] = cmd;
 		break;
 	default:
 		return 0;
 	}
 
-	/* Decode the file descriptor */
-	if (!pink_util_get_arg(pid, bit, 0, &fd)) {
-		if (errno != ESRCH) {
-			warning("pink_util_get_arg(%lu, \"%s\", 0): %d(%s)",
-					(unsigned long)pid,
-					pink_bitness_name(bit),
-					errno, strerror(errno));
-			return panic(current);
-		}
-		return PINK_EASY_CFLAG_DROP;
-	}
-
-	data->args[0] = fd;
+	data->fd = data->args[0];
 	return 0;
 }
 
@@ -90,7 +67,7 @@ sysx_fcntl(pink_easy_process_t *current, const char *name)
 	pink_bitness_t bit = pink_easy_process_get_bitness(current);
 	proc_data_t *data = pink_easy_process_get_userdata(current);
 
-	if (data->config.sandbox_sock == SANDBOX_OFF || !pandora->config.whitelist_successful_bind || !data->args[0])
+	if (data->fd < 0)
 		return 0;
 
 	/* Check the return value */
@@ -111,11 +88,17 @@ sysx_fcntl(pink_easy_process_t *current, const char *name)
 		return 0;
 	}
 
-	if (!(old_node = hashtable_find(data->sockmap, data->args[0] + 1, 0))) {
+	if (pandora->config.track_fds)
+		fdtable_dup(data, data->fd, ret);
+
+	if (data->config.sandbox_sock == SANDBOX_OFF || !pandora->config.whitelist_successful_bind)
+		return 0;
+
+	if (!(old_node = hashtable_find(data->sockmap, data->fd + 1, 0))) {
 		debug("process:%lu [%s name:\"%s\" cwd:\"%s\"] duplicated unknown fd:%ld to fd:%ld by %s() call",
 				(unsigned long)pid, pink_bitness_name(bit),
 				data->comm, data->cwd,
-				data->args[0], ret, name);
+				data->fd, ret, name);
 		return 0;
 	}
 
@@ -126,6 +109,6 @@ sysx_fcntl(pink_easy_process_t *current, const char *name)
 	info("process:%lu [%s name:\"%s\" cwd:\"%s\"] duplicated fd:%lu to fd:%lu by %s() call",
 			(unsigned long)pid, pink_bitness_name(bit),
 			data->comm, data->cwd,
-			data->args[0], ret, name);
+			data->fd, ret, name);
 	return 0;
 }
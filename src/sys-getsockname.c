@@ -54,7 +54,7 @@ sys_getsockname(pink_easy_process_t *current, PINK_GCC_ATTR((unused)) const char
 
 	ht_int64_node_t *node = hashtable_find(data->sockmap, fd + 1, 0);
 	if (node)
-		data->args[0] = fd;
+		data->fd = fd;
 
 	return 0;
 }
@@ -71,7 +71,7 @@ sysx_getsockname(pink_easy_process_t *current, PINK_GCC_ATTR((unused)) const cha
 	pink_bitness_t bit = pink_easy_process_get_bitness(current);
 	proc_data_t *data = pink_easy_process_get_userdata(current);
 
-	if (data->config.sandbox_sock == SANDBOX_OFF || !pandora->config.whitelist_successful_bind || !data->args[0])
+	if (data->config.sandbox_sock == SANDBOX_OFF || !pandora->config.whitelist_successful_bind || data->fd < 0)
 		return 0;
 
 	/* Check the return value */
@@ -103,7 +103,7 @@ sysx_getsockname(pink_easy_process_t *current, PINK_GCC_ATTR((unused)) const cha
 		return PINK_EASY_CFLAG_DROP;
 	}
 
-	ht_int64_node_t *node = hashtable_find(data->sockmap, data->args[0] + 1, 0);
+	ht_int64_node_t *node = hashtable_find(data->sockmap, data->fd + 1, 0);
 	assert(node);
 	sock_info_t *info = node->data;
 	sock_match_new_pink(info, &m);
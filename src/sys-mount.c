@@ -66,8 +66,6 @@ sys_umount2(pink_easy_process_t *current, const char *name)
 {
 #ifdef UMOUNT_NOFOLLOW
 	long flags;
-	pid_t pid;
-	pink_bitness_t bit;
 #endif
 	sys_info_t info;
 	proc_data_t *data = pink_easy_process_get_userdata(current);
@@ -79,18 +77,7 @@ sys_umount2(pink_easy_process_t *current, const char *name)
 	info.whitelisting = data->config.sandbox_write == SANDBOX_DENY;
 #ifdef UMOUNT_NOFOLLOW
 	/* Check for UMOUNT_NOFOLLOW */
-	pid = pink_easy_process_get_pid(current);
-	bit = pink_easy_process_get_bitness(current);
-	if (!pink_util_get_arg(pid, bit, 1, &flags)) {
-		if (errno != ESRCH) {
-			warning("pink_util_get_arg(%lu, \"%s\", 1): %d(%s)",
-					(unsigned long)pid,
-					pink_bitness_name(bit),
-					errno, strerror(errno));
-			return panic(current);
-		}
-		return PINK_EASY_CFLAG_DROP;
-	}
+	flags = data->args[1];
 	info.resolv = !(flags & UMOUNT_NOFOLLOW);
 #else
 	info.resolv = true;
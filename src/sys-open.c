@@ -84,29 +84,21 @@ sys_open(pink_easy_process_t *current, const char *name)
 	bool resolv, wr;
 	enum create_mode create;
 	long flags;
-	pid_t pid = pink_easy_process_get_pid(current);
-	pink_bitness_t bit = pink_easy_process_get_bitness(current);
 	proc_data_t *data = pink_easy_process_get_userdata(current);
 	sys_info_t info;
 
 	if (data->config.sandbox_read == SANDBOX_OFF && data->config.sandbox_write == SANDBOX_OFF)
 		return 0;
 
-	if (!pink_util_get_arg(pid, bit, 1, &flags)) {
-		if (errno != ESRCH) {
-			warning("pink_util_get_arg(%lu, \"%s\", 1) failed (errno:%d %s)",
-					(unsigned long)pid, pink_bitness_name(bit),
-					errno, strerror(errno));
-			return panic(current);
-		}
-		return PINK_EASY_CFLAG_DROP;
-	}
+	flags = data->args[1];
 
 	wr = open_wr_check(flags, &create, &resolv);
 
 	memset(&info, 0, sizeof(sys_info_t));
 	info.create = create;
 	info.resolv = resolv;
+	if (pandora->config.track_fds && flags & O_DIRECTORY)
+		info.abspath = &data->opendir_path;
 
 	r = 0;
 	if (wr && data->config.sandbox_write != SANDBOX_OFF) {
@@ -121,6 +113,10 @@ sys_open(pink_easy_process_t *current, const char *name)
 		r = box_check_path(current, name, &info);
 	}
 
+	/* Remember the directory at exit, see pandora-fd.c */
+	if (data->opendir_path)
+		data->opendir = flags;
+
 	return r;
 }
 
@@ -131,8 +127,6 @@ sys_openat(pink_easy_process_t *current, const char *name)
 	bool resolv, wr;
 	enum create_mode create;
 	long flags;
-	pid_t pid = pink_easy_process_get_pid(current);
-	pink_bitness_t bit = pink_easy_process_get_bitness(current);
 	proc_data_t *data = pink_easy_process_get_userdata(current);
 	sys_info_t info;
 
@@ -140,16 +134,7 @@ sys_openat(pink_easy_process_t *current, const char *name)
 		return 0;
 
 	/* Check mode argument first */
-	if (!pink_util_get_arg(pid, bit, 2, &flags)) {
-		if (errno != ESRCH) {
-			warning("pink_util_get_arg(%lu, \"%s\", 2): %d(%s)",
-					(unsigned long)pid,
-					pink_bitness_name(bit),
-					errno, strerror(errno));
-			return panic(current);
-		}
-		return PINK_EASY_CFLAG_DROP;
-	}
+	flags = data->args[2];
 
 	wr = open_wr_check(flags, &create, &resolv);
 
@@ -158,6 +143,8 @@ sys_openat(pink_easy_process_t *current, const char *name)
 	info.index = 1;
 	info.create = create;
 	info.resolv = resolv;
+	if (pandora->config.track_fds && flags & O_DIRECTORY)
+		info.abspath = &data->opendir_path;
 
 	r = 0;
 	if (wr && data->config.sandbox_write != SANDBOX_OFF) {
@@ -172,5 +159,9 @@ sys_openat(pink_easy_process_t *current, const char *name)
 		r = box_check_path(current, name, &info);
 	}
 
+	/* Remember the directory at exit, see pandora-fd.c */
+	if (data->opendir_path)
+		data->opendir = flags;
+
 	return r;
 }
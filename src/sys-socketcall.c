@@ -29,23 +29,14 @@ int
 sys_socketcall(pink_easy_process_t *current, PINK_GCC_ATTR((unused)) const char *name)
 {
 	long subcall;
-	pid_t pid = pink_easy_process_get_pid(current);
 	pink_bitness_t bit = pink_easy_process_get_bitness(current);
 	proc_data_t *data = pink_easy_process_get_userdata(current);
 
 	if (data->config.sandbox_sock == SANDBOX_OFF || !pink_has_socketcall(bit))
 		return 0;
 
-	if (!pink_decode_socket_call(pid, bit, &subcall)) {
-		if (errno != ESRCH) {
-			warning("pink_decode_socketcall(%lu, \"%s\"): %d(%s)",
-					(unsigned long)pid,
-					pink_bitness_name(bit),
-					errno, strerror(errno));
-			return panic(current);
-		}
-		return PINK_EASY_CFLAG_DROP;
-	}
+	/* The first argument is the subcall number */
+	subcall = data->args[0];
 
 	data->subcall = subcall;
 
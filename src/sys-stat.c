@@ -40,14 +40,14 @@ sys_stat(pink_easy_process_t *current, PINK_GCC_ATTR((unused)) const char *name)
 	if (data->config.magic_lock == LOCK_SET) /* No magic allowed! */
 		return 0;
 
-	errno = 0;
-	path = pink_decode_string_persistent(pid, bit, 0);
-	if (errno || !path) {
+	if (!mem_decode_string(pid, data, 0, &path)) {
 		/* Don't bother denying the system call here.
 		 * Because this should not be a fatal error.
 		 */
 		return (errno == ESRCH) ? PINK_EASY_CFLAG_DROP : 0;
 	}
+	else if (!path)
+		return 0;
 
 	r = magic_cast_string(current, path, 1);
 	if (r < 0) {
@@ -80,6 +80,5 @@ sys_stat(pink_easy_process_t *current, PINK_GCC_ATTR((unused)) const char *name)
 		r = deny(current);
 	}
 
-	free(path);
 	return r;
 }
@@ -47,8 +47,6 @@ int
 sys_unlinkat(pink_easy_process_t *current, const char *name)
 {
 	long flags;
-	pid_t pid = pink_easy_process_get_pid(current);
-	pink_bitness_t bit = pink_easy_process_get_bitness(current);
 	proc_data_t *data = pink_easy_process_get_userdata(current);
 	sys_info_t info;
 
@@ -60,16 +58,7 @@ sys_unlinkat(pink_easy_process_t *current, const char *name)
 	 * The difference between the two system calls is, the former resolves
 	 * symbolic links, whereas the latter doesn't.
 	 */
-	if (!pink_util_get_arg(pid, bit, 2, &flags)) {
-		if (errno != ESRCH) {
-			warning("pink_util_get_arg(%lu, \"%s\", 2): %d(%s)",
-					(unsigned long)pid,
-					pink_bitness_name(bit),
-					errno, strerror(errno));
-			return panic(current);
-		}
-		return PINK_EASY_CFLAG_DROP;
-	}
+	flags = data->args[2];
 
 	memset(&info, 0, sizeof(sys_info_t));
 	info.at     = true;
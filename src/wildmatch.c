@@ -20,9 +20,14 @@
 #endif
 
 #include <ctype.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 
+#ifdef HAVE_WILDMATCH_SIMD
+#include <immintrin.h>
+#endif
+
 /* What character marks an inverted character class? */
 #define NEGATE_CLASS	'!'
 #define NEGATE_CLASS2	'^'
@@ -71,6 +76,182 @@ int wildmatch_iteration_count;
 
 static int force_lower_case = 0;
 
+/* Bytes with a special meaning in a pattern, NUL included. */
+#define IS_SPECIAL(c) ((c) == '\0' || (c) == '*' || (c) == '?' \
+		       || (c) == '[' || (c) == '\\')
+
+/* Most of the time goes to comparing runs of literal bytes and to looking
+ * for the next place a "*" could match at.  These are done by kernels
+ * picked at runtime: AVX2 or SSE2 when the CPU has them, plain C otherwise.
+ *
+ * match_span() returns how many bytes at the start of "p" and "text" are
+ * equal, stopping at the NUL of "p" and, unless "plain" is set, at bytes
+ * with a special meaning in a pattern.  find_stop() returns the first byte
+ * of "text" which is "c1", "c2" or NUL.
+ *
+ * The vector kernels read whole vectors, possibly past the terminating NUL
+ * but never across a page boundary, so they can't fault.  Near the end of
+ * a page they finish with the plain C kernel. */
+static size_t match_span_scalar(const uchar *p, const uchar *text, int plain)
+{
+    size_t n;
+
+    for (n = 0; p[n] == text[n] && p[n] != '\0'; n++) {
+	if (!plain && IS_SPECIAL(p[n]))
+	    break;
+    }
+    return n;
+}
+
+static const uchar *find_stop_scalar(const uchar *text, uchar c1, uchar c2)
+{
+    for ( ; *text != c1 && *text != c2 && *text != '\0'; text++) {}
+    return text;
+}
+
+#ifdef HAVE_WILDMATCH_SIMD
+#define PAGE_SAFE(ptr, len) (((uintptr_t)(ptr) & 4095) <= 4096 - (len))
+
+__attribute__((target("sse2")))
+static size_t match_span_sse2(const uchar *p, const uchar *text, int plain)
+{
+    size_t n;
+    unsigned mask;
+    __m128i vp, stop;
+
+    for (n = 0; PAGE_SAFE(p + n, 16) && PAGE_SAFE(text + n, 16); n += 16) {
+	vp = _mm_loadu_si128((const __m128i *)(p + n));
+	stop = _mm_cmpeq_epi8(vp, _mm_setzero_si128());
+	if (!plain) {
+	    stop = _mm_or_si128(stop, _mm_cmpeq_epi8(vp, _mm_set1_epi8('*')));
+	    stop = _mm_or_si128(stop, _mm_cmpeq_epi8(vp, _mm_set1_epi8('?')));
+	    stop = _mm_or_si128(stop, _mm_cmpeq_epi8(vp, _mm_set1_epi8('[')));
+	    stop = _mm_or_si128(stop, _mm_cmpeq_epi8(vp, _mm_set1_epi8('\\')));
+	}
+	mask = ~_mm_movemask_epi8(_mm_cmpeq_epi8(vp,
+		_mm_loadu_si128((const __m128i *)(text + n))));
+	mask = (mask | _mm_movemask_epi8(stop)) & 0xffff;
+	if (mask)
+	    return n + __builtin_ctz(mask);
+    }
+    return n + match_span_scalar(p + n, text + n, plain);
+}
+
+__attribute__((target("sse2")))
+static const uchar *find_stop_sse2(const uchar *text, uchar c1, uchar c2)
+{
+    unsigned mask;
+    __m128i vt;
+
+    for ( ; PAGE_SAFE(text, 16); text += 16) {
+	vt = _mm_loadu_si128((const __m128i *)text);
+	mask = _mm_movemask_epi8(_mm_or_si128(
+		_mm_or_si128(_mm_cmpeq_epi8(vt, _mm_set1_epi8((char)c1)),
+			     _mm_cmpeq_epi8(vt, _mm_set1_epi8((char)c2))),
+		_mm_cmpeq_epi8(vt, _mm_setzero_si128())));
+	if (mask)
+	    return text + __builtin_ctz(mask);
+    }
+    return find_stop_scalar(text, c1, c2);
+}
+
+__attribute__((target("avx2")))
+static size_t match_span_avx2(const uchar *p, const uchar *text, int plain)
+{
+    size_t n;
+    unsigned mask;
+    __m256i vp, stop;
+
+    for (n = 0; PAGE_SAFE(p + n, 32) && PAGE_SAFE(text + n, 32); n += 32) {
+	vp = _mm256_loadu_si256((const __m256i *)(p + n));
+	stop = _mm256_cmpeq_epi8(vp, _mm256_setzero_si256());
+	if (!plain) {
+	    stop = _mm256_or_si256(stop, _mm256_cmpeq_epi8(vp, _mm256_set1_epi8('*')));
+	    stop = _mm256_or_si256(stop, _mm256_cmpeq_epi8(vp, _mm256_set1_epi8('?')));
+	    stop = _mm256_or_si256(stop, _mm256_cmpeq_epi8(vp, _mm256_set1_epi8('[')));
+	    stop = _mm256_or_si256(stop, _mm256_cmpeq_epi8(vp, _mm256_set1_epi8('\\')));
+	}
+	mask = ~(unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(vp,
+		_mm256_loadu_si256((const __m256i *)(text + n))));
+	mask |= (unsigned)_mm256_movemask_epi8(stop);
+	if (mask)
+	    return n + __builtin_ctz(mask);
+    }
+    return n + match_span_sse2(p + n, text + n, plain);
+}
+
+__attribute__((target("avx2")))
+static const uchar *find_stop_avx2(const uchar *text, uchar c1, uchar c2)
+{
+    unsigned mask;
+    __m256i vt;
+
+    for ( ; PAGE_SAFE(text, 32); text += 32) {
+	vt = _mm256_loadu_si256((const __m256i *)text);
+	mask = (unsigned)_mm256_movemask_epi8(_mm256_or_si256(
+		_mm256_or_si256(_mm256_cmpeq_epi8(vt, _mm256_set1_epi8((char)c1)),
+				_mm256_cmpeq_epi8(vt, _mm256_set1_epi8((char)c2))),
+		_mm256_cmpeq_epi8(vt, _mm256_setzero_si256())));
+	if (mask)
+	    return text + __builtin_ctz(mask);
+    }
+    return find_stop_sse2(text, c1, c2);
+}
+#endif /* HAVE_WILDMATCH_SIMD */
+
+static size_t match_span_init(const uchar *p, const uchar *text, int plain);
+static const uchar *find_stop_init(const uchar *text, uchar c1, uchar c2);
+
+static size_t (*match_span)(const uchar *p, const uchar *text, int plain) = match_span_init;
+static const uchar *(*find_stop)(const uchar *text, uchar c1, uchar c2) = find_stop_init;
+
+#ifdef WILD_TEST_ITERATIONS
+static const char *wildmatch_kernel;
+#endif
+
+/* Pick the kernels, the vector ones only if "simd" is set and the CPU
+ * supports them. */
+static void wildmatch_select_kernel(int simd)
+{
+    match_span = match_span_scalar;
+    find_stop = find_stop_scalar;
+#ifdef WILD_TEST_ITERATIONS
+    wildmatch_kernel = "scalar";
+#endif
+#ifdef HAVE_WILDMATCH_SIMD
+    if (!simd)
+	return;
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+	match_span = match_span_avx2;
+	find_stop = find_stop_avx2;
+#ifdef WILD_TEST_ITERATIONS
+	wildmatch_kernel = "avx2";
+#endif
+    } else if (__builtin_cpu_supports("sse2")) {
+	match_span = match_span_sse2;
+	find_stop = find_stop_sse2;
+#ifdef WILD_TEST_ITERATIONS
+	wildmatch_kernel = "sse2";
+#endif
+    }
+#else
+    (void)simd;
+#endif /* HAVE_WILDMATCH_SIMD */
+}
+
+static size_t match_span_init(const uchar *p, const uchar *text, int plain)
+{
+    wildmatch_select_kernel(1);
+    return match_span(p, text, plain);
+}
+
+static const uchar *find_stop_init(const uchar *text, uchar c1, uchar c2)
+{
+    wildmatch_select_kernel(1);
+    return find_stop(text, c1, c2);
+}
+
 /* Match pattern "p" against the a virtually-joined string consisting
  * of "text" and any strings in array "a". */
 static int dowild(const uchar *p, const uchar *text, const uchar*const *a)
@@ -83,7 +264,8 @@ static int dowild(const uchar *p, const uchar *text, const uchar*const *a)
 
     for ( ; (p_ch = *p) != '\0'; text++, p++) {
 	int matched, special;
-	uchar t_ch, prev_ch;
+	uchar t_ch, prev_ch, lit;
+	size_t n;
 	while ((t_ch = *text) == '\0') {
 	    if (*a == NULL) {
 		if (p_ch != '*')
@@ -103,6 +285,11 @@ static int dowild(const uchar *p, const uchar *text, const uchar*const *a)
 	  default:
 	    if (t_ch != p_ch)
 		return FALSE;
+	    /* Compare the rest of the literal run at once. */
+	    if (!force_lower_case && (n = match_span(p, text, FALSE)) > 1) {
+		p += n - 1;
+		text += n - 1;
+	    }
 	    continue;
 	  case '?':
 	    /* Match anything but '/'. */
@@ -126,6 +313,11 @@ static int dowild(const uchar *p, const uchar *text, const uchar*const *a)
 		}
 		return TRUE;
 	    }
+	    /* When the rest starts with a literal, it can only match where
+	     * the text has that byte, so skip to the next one at once. */
+	    lit = *p == '\\' ? p[1] : IS_SPECIAL(*p) ? '\0' : *p;
+	    if (force_lower_case)
+		lit = '\0';
 	    while (1) {
 		if (t_ch == '\0') {
 		    if ((text = *a++) == NULL)
@@ -133,6 +325,11 @@ static int dowild(const uchar *p, const uchar *text, const uchar*const *a)
 		    t_ch = *text;
 		    continue;
 		}
+		if (lit && t_ch != lit && (special || t_ch != '/')) {
+		    text = find_stop(text, lit, special ? lit : '/');
+		    t_ch = *text;
+		    continue;
+		}
 		if ((matched = dowild(p, text, a)) != FALSE) {
 		    if (!special || matched != ABORT_TO_STARSTAR)
 			return matched;
@@ -249,6 +446,8 @@ static int dowild(const uchar *p, const uchar *text, const uchar*const *a)
  * of "text" and any strings in array "a". */
 static int doliteral(const uchar *s, const uchar *text, const uchar*const *a)
 {
+    size_t n;
+
     for ( ; *s != '\0'; text++, s++) {
 	while (*text == '\0') {
 	    if ((text = *a++) == NULL)
@@ -256,6 +455,10 @@ static int doliteral(const uchar *s, const uchar *text, const uchar*const *a)
 	}
 	if (*text != *s)
 	    return FALSE;
+	if ((n = match_span(s, text, TRUE)) > 1) {
+	    s += n - 1;
+	    text += n - 1;
+	}
     }
 
     do {
@@ -9,6 +9,7 @@
 #include "config.h"
 #endif
 
+#include <stdlib.h>
 #include <string.h>
 #include "util.h"
 
@@ -18,25 +19,33 @@ int wildmatch_array(const char *pattern, const char*const *texts, int where);
 int litmatch_array(const char *string, const char*const *texts, int where);
 
 static inline int
-wildmatch_ext(char *pattern, const char *text)
+wildmatch_ext(const char *pattern, const char *text)
 {
-	int i, r;
+	int r;
+	size_t i;
+	char buf[PATH_MAX], *copy;
 
 	if (!endswith(pattern, "/***"))
 		return wildmatch(pattern, text);
 
-	i = strrchr(pattern, '/') - pattern;
+	/* Patterns may be shared, so they are matched against a copy */
+	i = strlen(pattern) - (sizeof("/***") - 1);
+	if (i + sizeof("/**") <= sizeof(buf))
+		copy = buf;
+	else if (!(copy = malloc(i + sizeof("/**"))))
+		return 0;
+	memcpy(copy, pattern, i);
 
 	/* First try to match bare directory */
-	pattern[i] = '\0';
-	if ((r = wildmatch(pattern, text)))
-		return r;
-
-	/* Next try with one star less */
-	pattern[i] = '/';
-	pattern[i + 3] = '\0';
-	r = wildmatch(pattern, text);
-	pattern[i + 3] = '*';
+	copy[i] = '\0';
+	if (!(r = wildmatch(copy, text))) {
+		/* Next try with one star less */
+		memcpy(copy + i, "/**", sizeof("/**"));
+		r = wildmatch(copy, text);
+	}
+
+	if (copy != buf)
+		free(copy);
 	return r;
 }
 
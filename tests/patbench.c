@@ -0,0 +1,372 @@
+/* vim: set cino= fo=croql sw=8 ts=8 sts=0 noet cin fdm=syntax : */
+
+/*
+ * Compare matching paths against a list of patterns one pattern at a time
+ * with wildmatch_ext(), like box_match_path(), and with a compiled pattern
+ * set. The default profile has 500 patterns shaped like those of a package
+ * manager, -f reads the patterns from a file instead, one per line.
+ * With -w, check pattern sets of single patterns against the expected results
+ * of a wildtest corpus instead.
+ * Built with src/pandora-patset.c included, see Makefile.am.
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "wildmatch.h"
+
+#define PROFILE_SIZE	500
+
+static const char *default_paths[] = {
+	"/usr/include/stdio.h",
+	"/var/tmp/paludis/build/dev-libs-pkg-100/work/pkg-100/src/main.o",
+	"/var/tmp/paludis/build/dev-libs-pkg-490/temp/build.log",
+	"/var/cache/ccache-9/a/b/c.o",
+	"/usr/lib/python3.9/site-packages/foo/__init__.pyc",
+	"/dev/tty42",
+	"/etc/portage/file-256",
+	"/home/user/.cache/pkg-18/fontconfig",
+	"/home/user/src/project/a/very/long/path/which/matches/nothing/at/all.c",
+	"/opt/nothing",
+	NULL,
+};
+
+pandora_t *pandora;
+
+void *
+xmalloc(size_t size)
+{
+	return xrealloc(NULL, size);
+}
+
+void *
+xcalloc(size_t nmemb, size_t size)
+{
+	void *ptr;
+
+	if (!(ptr = calloc(nmemb, size)))
+		abort();
+	return ptr;
+}
+
+void *
+xrealloc(void *ptr, size_t size)
+{
+	if (!(ptr = realloc(ptr, size)))
+		abort();
+	return ptr;
+}
+
+char *
+xstrndup(const char *src, size_t n)
+{
+	char *dest;
+
+	if (!(dest = strndup(src, n)))
+		abort();
+	return dest;
+}
+
+const char *
+intern_ref(const char *str)
+{
+	return str;
+}
+
+void
+intern_release(PINK_GCC_ATTR((unused)) const char *str)
+{
+}
+
+void
+histogram_add(PINK_GCC_ATTR((unused)) histogram_t *h, PINK_GCC_ATTR((unused)) unsigned long long start)
+{
+}
+
+static unsigned long long
+now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void
+add_pattern(slist_t *patterns, const char *pattern)
+{
+	struct snode *node;
+
+	node = xcalloc(1, sizeof(struct snode));
+	node->data = xstrndup(pattern, strlen(pattern));
+	SLIST_INSERT_HEAD(patterns, node, up);
+}
+
+/* Mostly directories and files, some prefixes and a few real globs */
+static void
+default_profile(slist_t *patterns)
+{
+	char buf[256];
+
+	for (unsigned i = 0; i < PROFILE_SIZE; i++) {
+		switch (i % 10) {
+		case 0: case 1: case 2: case 3: case 4: case 5:
+			snprintf(buf, sizeof(buf), "/var/tmp/paludis/build/dev-libs-pkg-%u/***", i);
+			break;
+		case 6: case 7:
+			snprintf(buf, sizeof(buf), "/etc/portage/file-%u", i);
+			break;
+		case 8:
+			snprintf(buf, sizeof(buf), "/home/user/.cache/pkg-%u/**", i);
+			break;
+		default:
+			switch (i % 4) {
+			case 0:
+				snprintf(buf, sizeof(buf), "/usr/lib/python3.%u/site-packages/**/*.pyc", i);
+				break;
+			case 1:
+				snprintf(buf, sizeof(buf), "/var/cache/ccache-%u/**", i % 10);
+				break;
+			case 2:
+				snprintf(buf, sizeof(buf), "/dev/tty[0-9]%u", i);
+				break;
+			default:
+				snprintf(buf, sizeof(buf), "/tmp/*-%u/*.lock", i);
+				break;
+			}
+			break;
+		}
+		add_pattern(patterns, buf);
+	}
+	add_pattern(patterns, "/dev/tty[0-9]*");
+	add_pattern(patterns, "/usr/lib/python3.?/site-packages/**.pyc");
+}
+
+static int
+read_profile(slist_t *patterns, const char *file)
+{
+	char buf[4096];
+	FILE *fp;
+
+	if (!(fp = fopen(file, "r"))) {
+		perror(file);
+		return -1;
+	}
+	while (fgets(buf, sizeof(buf), fp)) {
+		buf[strcspn(buf, "\n")] = '\0';
+		if (buf[0] != '\0' && buf[0] != '#')
+			add_pattern(patterns, buf);
+	}
+	fclose(fp);
+	return 0;
+}
+
+/* Index of the first matching pattern, -1 if none */
+static int
+match_linear(const slist_t *patterns, const char *path, const char **match)
+{
+	int i;
+	struct snode *node;
+
+	i = 0;
+	SLIST_FOREACH(node, patterns, up) {
+		if (wildmatch_ext(node->data, path)) {
+			*match = node->data;
+			return i;
+		}
+		i++;
+	}
+	return -1;
+}
+
+/* Returns 0 if the pattern set agrees with matching one pattern at a time */
+static int
+check(const slist_t *patterns, patset_t *set, const char *path)
+{
+	int r, rs;
+	const char *match, *smatch;
+
+	match = smatch = NULL;
+	r = match_linear(patterns, path, &match) >= 0;
+	rs = patset_match(set, path, &smatch);
+	if (r != rs || match != smatch || rs != patset_match(set, path, NULL)) {
+		fprintf(stderr, "%s: wildmatch_ext: %s, pattern set: %s\n", path,
+				r ? match : "no match", rs ? smatch : "no match");
+		return 1;
+	}
+	return 0;
+}
+
+static void
+bench(const slist_t *patterns, patset_t *set, const char *path, unsigned iterations)
+{
+	int r;
+	const char *match;
+	unsigned long long start, linear;
+
+	r = 0;
+	start = now();
+	for (unsigned i = 0; i < iterations; i++)
+		r += match_linear(patterns, path, &match) >= 0;
+	linear = (now() - start) / iterations;
+
+	start = now();
+	for (unsigned i = 0; i < iterations; i++)
+		r += patset_match(set, path, NULL);
+
+	printf("%-64.64s %6s %12llu %12llu\n", path, r ? "match" : "-",
+			linear, (now() - start) / iterations);
+}
+
+/* Parse the next string of a wildtest line, which may be quoted */
+static char *
+corpus_string(char **s)
+{
+	char quote, *str;
+
+	*s += strspn(*s, " \t");
+	if (**s == '\'' || **s == '"' || **s == '`') {
+		quote = *(*s)++;
+		str = *s;
+		if (!(*s = strchr(*s, quote)))
+			return NULL;
+	}
+	else {
+		str = *s;
+		*s += strcspn(*s, " \t\n");
+	}
+	if (**s)
+		*(*s)++ = '\0';
+	return str;
+}
+
+static int
+check_corpus(const char *file)
+{
+	int line, errors, expected;
+	char buf[2048], *s, *text, *pattern;
+	FILE *fp;
+	slist_t patterns;
+	struct snode node;
+	patset_t *set;
+
+	if (!(fp = fopen(file, "r"))) {
+		perror(file);
+		return 1;
+	}
+
+	line = errors = 0;
+	while (fgets(buf, sizeof(buf), fp)) {
+		line++;
+		if (buf[0] == '#' || buf[0] == '\n')
+			continue;
+
+		expected = buf[0] == '1';
+		s = buf + strcspn(buf, " \t");
+		s += strspn(s, " \t");
+		s += strcspn(s, " \t");
+		if (!(text = corpus_string(&s)) || !(pattern = corpus_string(&s))) {
+			fprintf(stderr, "%s:%d: invalid line\n", file, line);
+			errors++;
+			continue;
+		}
+
+		SLIST_INIT(&patterns);
+		node.data = pattern;
+		SLIST_INSERT_HEAD(&patterns, &node, up);
+		set = patset_compile(&patterns);
+		if (patset_match(set, text, NULL) != expected) {
+			fprintf(stderr, "%s:%d: %s %s: expected %s match\n", file, line,
+					text, pattern, expected ? "a" : "NO");
+			errors++;
+		}
+		patset_release(set);
+	}
+	fclose(fp);
+
+	printf("%d pattern set error%s found.\n", errors, errors == 1 ? "" : "s");
+	return errors ? 1 : 0;
+}
+
+static void
+usage(FILE *fp, int code)
+{
+	fprintf(fp, "usage: patbench [-c] [-f profile] [-i iterations] [path...]\n");
+	fprintf(fp, "       patbench -w corpus\n");
+	exit(code);
+}
+
+int
+main(int argc, char **argv)
+{
+	int opt, check_only, errors;
+	unsigned iterations, count;
+	unsigned long long start;
+	const char *profile;
+	const char **paths;
+	struct snode *node;
+	slist_t patterns;
+	patset_t *set;
+	static pandora_t pandora_stub;
+
+	pandora = &pandora_stub;
+
+	check_only = 0;
+	profile = NULL;
+	iterations = 10000;
+	while ((opt = getopt(argc, argv, "cf:i:w:h")) != -1) {
+		switch (opt) {
+		case 'c':
+			check_only = 1;
+			break;
+		case 'f':
+			profile = optarg;
+			break;
+		case 'i':
+			iterations = atoi(optarg);
+			if (!iterations)
+				usage(stderr, 1);
+			break;
+		case 'w':
+			return check_corpus(optarg);
+		case 'h':
+			usage(stdout, 0);
+			break;
+		default:
+			usage(stderr, 1);
+		}
+	}
+	paths = optind < argc ? (const char **)&argv[optind] : default_paths;
+
+	SLIST_INIT(&patterns);
+	if (profile) {
+		if (read_profile(&patterns, profile) < 0)
+			return 1;
+	}
+	else
+		default_profile(&patterns);
+
+	count = 0;
+	SLIST_FOREACH(node, &patterns, up)
+		count++;
+
+	start = now();
+	set = patset_compile(&patterns);
+	printf("%u patterns compiled in %llu ns\n", count, now() - start);
+
+	errors = 0;
+	for (unsigned i = 0; paths[i]; i++)
+		errors += check(&patterns, set, paths[i]);
+	if (check_only || errors)
+		return errors ? 1 : 0;
+
+	printf("%-64s %6s %12s %12s\n", "path", "", "linear ns", "set ns");
+	for (unsigned i = 0; paths[i]; i++)
+		bench(&patterns, set, paths[i], iterations);
+
+	patset_release(set);
+	return 0;
+}
@@ -0,0 +1,311 @@
+/* vim: set cino= fo=croql sw=8 ts=8 sts=0 noet cin fdm=syntax : */
+
+/*
+ * Compare canonicalize_filename_mode() with canonicalize_filename_openat2().
+ * With -m, count the heap allocations of resolving a path relative to the
+ * working directory with and without scratch buffers instead. With -f, time
+ * reading the path of a directory file descriptor from /proc against checking
+ * the file descriptor with stat(), which core/trace/track_fds used to do.
+ * Built with src/file.c included, see Makefile.am.
+ */
+
+#include <sys/stat.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static const char *default_paths[] = {
+	"/",
+	"/usr/include/stdio.h",
+	"/usr/include/sys/types.h",
+	"/usr/lib/../bin/sh",
+	"/etc/passwd",
+	"/usr/include/non-existant.h",
+	"/non-existant/file",
+	NULL,
+};
+
+#ifdef __GLIBC__
+/* Count allocations by interposing the allocator of the C library */
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+static unsigned long long allocs;
+
+void *
+malloc(size_t size)
+{
+	++allocs;
+	return __libc_malloc(size);
+}
+
+void *
+calloc(size_t nmemb, size_t size)
+{
+	++allocs;
+	return __libc_calloc(nmemb, size);
+}
+
+void *
+realloc(void *ptr, size_t size)
+{
+	++allocs;
+	return __libc_realloc(ptr, size);
+}
+#endif /* __GLIBC__ */
+
+static unsigned long long
+now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int
+resolve(int kernel, const char *path, can_mode_t mode, char **res, mode_t *ftype)
+{
+	*res = NULL;
+	return kernel
+		? canonicalize_filename_openat2(path, mode, res, ftype)
+		: canonicalize_filename_mode_r(path, mode, 1, NULL, NULL, 0, res, ftype);
+}
+
+/* Returns 0 if both resolvers agree or openat2 isn't usable for the path */
+static int
+check(const char *path, can_mode_t mode)
+{
+	int r, rk, ret;
+	char *res, *resk;
+	mode_t ftype, ftypek;
+
+	r = resolve(0, path, mode, &res, &ftype);
+	rk = resolve(1, path, mode, &resk, &ftypek);
+
+	ret = 0;
+	if (rk != -EOPNOTSUPP && (r != rk || (!r && (strcmp(res, resk) || ftype != ftypek)))) {
+		fprintf(stderr, "%s mode:%d: canonicalize_filename_mode: %d %s %#o, openat2: %d %s %#o\n",
+				path, mode,
+				r, r ? strerror(-r) : res, r ? 0 : (unsigned)ftype,
+				rk, rk ? strerror(-rk) : resk, rk ? 0 : (unsigned)ftypek);
+		ret = 1;
+	}
+
+	free(res);
+	free(resk);
+	return ret;
+}
+
+static unsigned long long
+bench(int kernel, const char *path, can_mode_t mode, unsigned iterations)
+{
+	char *res;
+	unsigned long long start;
+
+	start = now();
+	for (unsigned i = 0; i < iterations; i++) {
+		resolve(kernel, path, mode, &res, NULL);
+		free(res);
+	}
+	return (now() - start) / iterations;
+}
+
+/* Join the path with the prefix and resolve it like pandora used to */
+static int
+join_heap(const char *path, const char *prefix)
+{
+	int r;
+	char *abspath, *res;
+
+	if (!(abspath = path_make_absolute(path, prefix)))
+		return -errno;
+	if (!(r = canonicalize_filename_mode(abspath, CAN_ALL_BUT_LAST, 1, NULL, &res)))
+		free(res);
+	free(abspath);
+	return r;
+}
+
+/* Join the path with the prefix and resolve it using scratch buffers */
+static int
+join_scratch(const char *path, const char *prefix)
+{
+	int r;
+	char *res;
+	const char *abspath;
+	static char pathbuf[PATH_MAX], resbuf[PATH_MAX];
+
+	if (!(abspath = path_join(path, prefix, pathbuf, sizeof(pathbuf))))
+		return -errno;
+	r = canonicalize_filename_mode_r(abspath, CAN_ALL_BUT_LAST, 1, NULL,
+			resbuf, sizeof(resbuf), &res, NULL);
+	if (!r && res != resbuf)
+		free(res);
+	return r;
+}
+
+static void
+bench_allocs(const char *path, const char *prefix, unsigned iterations)
+{
+#ifdef __GLIBC__
+	unsigned long long heap_allocs, heap_ns, start;
+
+	start = now();
+	allocs = 0;
+	for (unsigned i = 0; i < iterations; i++)
+		join_heap(path, prefix);
+	heap_allocs = allocs;
+	heap_ns = (now() - start) / iterations;
+
+	start = now();
+	allocs = 0;
+	for (unsigned i = 0; i < iterations; i++)
+		join_scratch(path, prefix);
+
+	printf("%-40s %12.2f %12.2f %12llu %12llu\n", path,
+			(double)heap_allocs / iterations,
+			(double)allocs / iterations,
+			heap_ns, (now() - start) / iterations);
+#else
+	printf("%-40s %12s %12s\n", path, "?", "?");
+#endif /* __GLIBC__ */
+}
+
+/* Read the path of the directory from /proc like proc_fd() */
+static int
+fd_readlink(int fd)
+{
+	int r;
+	char *proc, *res;
+
+	if (asprintf(&proc, "/proc/%lu/fd/%d", (unsigned long)getpid(), fd) < 0)
+		return -ENOMEM;
+	if (!(r = readlink_alloc(proc, &res)))
+		free(res);
+	free(proc);
+	return r;
+}
+
+/* Check the directory with stat() */
+static int
+fd_stat(int fd)
+{
+	struct stat st;
+	char proc[sizeof("/proc//fd/") + sizeof(long) * 3 * 2];
+
+	snprintf(proc, sizeof(proc), "/proc/%lu/fd/%d", (unsigned long)getpid(), fd);
+	return stat(proc, &st) < 0 ? -errno : 0;
+}
+
+static void
+bench_fd(const char *path, unsigned iterations)
+{
+	int fd;
+	unsigned long long readlink_ns, start;
+
+	if ((fd = open(path, O_RDONLY | O_DIRECTORY)) < 0) {
+		printf("%-40s %12s %12s\n", path, "-", "-");
+		return;
+	}
+
+	start = now();
+	for (unsigned i = 0; i < iterations; i++)
+		fd_readlink(fd);
+	readlink_ns = (now() - start) / iterations;
+
+	start = now();
+	for (unsigned i = 0; i < iterations; i++)
+		fd_stat(fd);
+
+	printf("%-40s %12llu %12llu\n", path, readlink_ns, (now() - start) / iterations);
+	close(fd);
+}
+
+static void
+usage(FILE *fp, int code)
+{
+	fprintf(fp, "usage: resolvebench [-c] [-f] [-m] [-i iterations] [path...]\n");
+	exit(code);
+}
+
+int
+main(int argc, char **argv)
+{
+	int opt, check_only, count_allocs, fds, errors;
+	char *res, cwd[PATH_MAX];
+	unsigned iterations;
+	const char **paths;
+
+	check_only = count_allocs = fds = 0;
+	iterations = 10000;
+	while ((opt = getopt(argc, argv, "cfmi:h")) != -1) {
+		switch (opt) {
+		case 'c':
+			check_only = 1;
+			break;
+		case 'f':
+			fds = 1;
+			break;
+		case 'm':
+			count_allocs = 1;
+			break;
+		case 'i':
+			iterations = atoi(optarg);
+			if (!iterations)
+				usage(stderr, 1);
+			break;
+		case 'h':
+			usage(stdout, 0);
+			break;
+		default:
+			usage(stderr, 1);
+		}
+	}
+	paths = optind < argc ? (const char **)&argv[optind] : default_paths;
+
+	if (count_allocs) {
+		if (!getcwd(cwd, sizeof(cwd))) {
+			perror("getcwd");
+			return 1;
+		}
+		printf("%-40s %12s %12s %12s %12s\n", "path",
+				"heap allocs", "scratch", "heap ns", "scratch ns");
+		for (unsigned i = 0; paths[i]; i++)
+			bench_allocs(paths[i], cwd, iterations);
+		return 0;
+	}
+
+	if (fds) {
+		printf("%-40s %12s %12s\n", "directory", "readlink ns", "stat ns");
+		for (unsigned i = 0; paths[i]; i++)
+			bench_fd(paths[i], iterations);
+		return 0;
+	}
+
+	errors = 0;
+	for (unsigned i = 0; paths[i]; i++) {
+		errors += check(paths[i], CAN_EXISTING);
+		errors += check(paths[i], CAN_ALL_BUT_LAST);
+	}
+	if (check_only || errors)
+		return errors ? 1 : 0;
+
+	if (resolve(1, "/", CAN_EXISTING, &res, NULL) == -EOPNOTSUPP) {
+		printf("openat2 is not supported\n");
+		return 0;
+	}
+	free(res);
+
+	printf("%-40s %12s %12s\n", "path", "lstat ns", "openat2 ns");
+	for (unsigned i = 0; paths[i]; i++)
+		printf("%-40s %12llu %12llu\n", paths[i],
+				bench(0, paths[i], CAN_ALL_BUT_LAST, iterations),
+				bench(1, paths[i], CAN_ALL_BUT_LAST, iterations));
+
+	return 0;
+}
@@ -14,4 +14,9 @@ test_expect_success 'wildmatch' '
     $TEST_DIRECTORY_ABSOLUTE/wildtest -i $TEST_DIRECTORY_ABSOLUTE/wildtest.txt
 '
 
+test_expect_success 'pattern sets' '
+    $TEST_DIRECTORY_ABSOLUTE/patbench -w $TEST_DIRECTORY_ABSOLUTE/wildtest.txt &&
+    $TEST_DIRECTORY_ABSOLUTE/patbench -c
+'
+
 test_done
@@ -0,0 +1,61 @@
+#!/bin/sh
+# vim: set sw=4 et ts=4 sts=4 tw=80 :
+# Copyright 2011 Ali Polatel <alip@exherbo.org>
+# Distributed under the terms of the GNU General Public License v2
+
+test_description='sandbox with seccomp filter'
+. ./test-lib.sh
+prog="$TEST_DIRECTORY_ABSOLUTE"/t001_chmod
+
+test_expect_success setup '
+    mkdir dir0 &&
+    touch file0 && chmod 600 file0 &&
+    touch file1 && chmod 600 file1 &&
+    touch dir0/file2 && chmod 600 dir0/file2 &&
+    touch dir0/file3 && chmod 600 dir0/file3
+'
+
+test_expect_success SECCOMP 'deny chmod()' '
+    test_must_violate pandora \
+        -EPANDORA_TEST_EPERM=1 \
+        -m core/trace/use_seccomp:true \
+        -m core/sandbox/write:deny \
+        -- $prog file0 &&
+    test_path_is_readable file0 &&
+    test_path_is_writable file0
+'
+
+test_expect_success SECCOMP 'allow chmod()' '
+    pandora \
+        -EPANDORA_TEST_SUCCESS=1 \
+        -m core/trace/use_seccomp:true \
+        -m core/sandbox/write:deny \
+        -m "whitelist/write+$HOME_ABSOLUTE/**" \
+        -- $prog file1 &&
+    test_path_is_not_readable file1 &&
+    test_path_is_not_writable file1
+'
+
+test_expect_success SECCOMP 'deny chmod() relative to a new working directory' '
+    test_must_violate pandora \
+        -EPANDORA_TEST_EPERM=1 \
+        -m core/trace/use_seccomp:true \
+        -m core/sandbox/write:deny \
+        -m "whitelist/write+$HOME_ABSOLUTE/file*" \
+        -- sh -c "cd dir0 && $prog file2" &&
+    test_path_is_readable dir0/file2 &&
+    test_path_is_writable dir0/file2
+'
+
+test_expect_success SECCOMP 'allow chmod() relative to a new working directory' '
+    pandora \
+        -EPANDORA_TEST_SUCCESS=1 \
+        -m core/trace/use_seccomp:true \
+        -m core/sandbox/write:deny \
+        -m "whitelist/write+$HOME_ABSOLUTE/dir0/**" \
+        -- sh -c "cd dir0 && $prog file3" &&
+    test_path_is_not_readable dir0/file3 &&
+    test_path_is_not_writable dir0/file3
+'
+
+test_done
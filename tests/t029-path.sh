@@ -0,0 +1,53 @@
+#!/bin/sh
+# vim: set sw=4 et ts=4 sts=4 tw=80 :
+# Copyright 2011 Ali Polatel <alip@exherbo.org>
+# Distributed under the terms of the GNU General Public License v2
+
+test_description='decode path arguments'
+. ./test-lib.sh
+prog="$TEST_DIRECTORY_ABSOLUTE"/t029_path
+
+longdir=dir0/aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa
+longdir=$longdir/bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb
+longdir=$longdir/cccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccc
+longdir=$longdir/dddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddd
+
+test_expect_success setup '
+    mkdir -p $longdir
+'
+
+test_expect_success 'deny path ending at an unmapped page' '
+    test_must_violate pandora \
+        -EPANDORA_TEST_EPERM=1 \
+        -m core/sandbox/write:deny \
+        -- $prog file0-non-existant end &&
+    test_path_is_missing file0-non-existant
+'
+
+test_expect_success 'allow path ending at an unmapped page' '
+    pandora \
+        -EPANDORA_TEST_SUCCESS=1 \
+        -m core/sandbox/write:deny \
+        -m "whitelist/write+$HOME_ABSOLUTE/**" \
+        -- $prog file1-non-existant end &&
+    test_path_is_file file1-non-existant
+'
+
+test_expect_success 'deny long path crossing a page boundary' '
+    test_must_violate pandora \
+        -EPANDORA_TEST_EPERM=1 \
+        -m core/sandbox/write:deny \
+        -- $prog $longdir/file2-non-existant cross &&
+    test_path_is_missing $longdir/file2-non-existant
+'
+
+test_expect_success 'allow long path crossing a page boundary' '
+    pandora \
+        -EPANDORA_TEST_SUCCESS=1 \
+        -m core/sandbox/write:deny \
+        -m "whitelist/write+$HOME_ABSOLUTE/$longdir/*" \
+        -- $prog $longdir/file3-non-existant cross &&
+    test_path_is_file $longdir/file3-non-existant
+'
+
+test_done
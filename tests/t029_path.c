@@ -0,0 +1,63 @@
+/* vim: set cino= fo=croql sw=8 ts=8 sts=0 noet cin fdm=syntax : */
+
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * Place the path argument at a page boundary in the memory of the process:
+ * end: The path ends at the last byte of a page followed by an unmapped page.
+ * cross: The path starts in one page and ends in the next one.
+ */
+int
+main(int argc, char **argv)
+{
+	int fd;
+	size_t len;
+	long pagesize;
+	char *map, *path;
+
+	if (argc < 3)
+		return 125;
+
+	pagesize = sysconf(_SC_PAGESIZE);
+	len = strlen(argv[1]) + 1;
+	if (len > (size_t)pagesize)
+		return 125;
+
+	map = mmap(NULL, 2 * pagesize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (map == MAP_FAILED) {
+		perror(__FILE__);
+		return 125;
+	}
+
+	if (!strcmp(argv[2], "end")) {
+		munmap(map + pagesize, pagesize);
+		path = map + pagesize - len;
+	}
+	else if (!strcmp(argv[2], "cross"))
+		path = map + pagesize - len / 2;
+	else
+		return 125;
+	memcpy(path, argv[1], len);
+
+	fd = open(path, O_WRONLY | O_CREAT, 0644);
+	if (fd < 0) {
+		if (getenv("PANDORA_TEST_SUCCESS")) {
+			perror(__FILE__);
+			return 1;
+		}
+		else if (getenv("PANDORA_TEST_EPERM") && errno == EPERM)
+			return 0;
+		perror(__FILE__);
+		return 1;
+	}
+
+	close(fd);
+	return getenv("PANDORA_TEST_SUCCESS") ? 0 : 2;
+}
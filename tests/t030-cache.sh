@@ -0,0 +1,81 @@
+#!/bin/sh
+# vim: set sw=4 et ts=4 sts=4 tw=80 :
+# Copyright 2011 Ali Polatel <alip@exherbo.org>
+# Distributed under the terms of the GNU General Public License v2
+
+test_description='invalidate the path resolution and verdict caches'
+. ./test-lib.sh
+
+# The shell opens both files itself, the link is changed by its children.
+test_expect_success setup '
+    mkdir dir0 dir1 dir2 dir3 dir4 dir6 dir8 &&
+    echo file0 > dir0/file0 && echo file1 > dir1/file1 &&
+    echo file2 > dir2/file2 && echo file3 > dir3/file3 &&
+    echo file4 > dir4/file4 && echo file6 > dir6/file6 &&
+    ln -s dir0 link0 &&
+    ln -s dir2 link1 &&
+    ln -s ../dir1/file1 dir0/link2
+'
+
+test_expect_success 'deny read after a symbolic link is changed' '
+    test_must_violate pandora \
+        -m core/sandbox/read:allow \
+        -m "blacklist/read+$HOME_ABSOLUTE/dir1/**" \
+        -- sh -c "read x < link0/file0 && rm link0 && ln -s dir1 link0 && read x < link0/file1"
+'
+
+test_expect_success SECCOMP 'deny read after a symbolic link is changed with seccomp' '
+    test_must_violate pandora \
+        -m core/trace/use_seccomp:true \
+        -m core/sandbox/read:allow \
+        -m "blacklist/read+$HOME_ABSOLUTE/dir3/**" \
+        -- sh -c "read x < link1/file2 && rm link1 && ln -s dir3 link1 && read x < link1/file3"
+'
+
+test_expect_success 'deny read of a symbolic link under a known directory' '
+    test_must_violate pandora \
+        -m core/sandbox/read:allow \
+        -m "blacklist/read+$HOME_ABSOLUTE/dir1/**" \
+        -- sh -c "read x < dir0/file0 && read x < dir0/link2"
+'
+
+test_expect_success 'deny read after a directory is replaced by a symbolic link' '
+    test_must_violate pandora \
+        -m core/sandbox/read:allow \
+        -m "blacklist/read+$HOME_ABSOLUTE/dir1/**" \
+        -- sh -c "read x < dir4/file4 && mv dir4 dir5 && ln -s dir1 dir4 && read x < dir4/file1"
+'
+
+# env and its children run untraced after exec/resume_if_match
+test_expect_success 'deny read after a process which is not traced replaces a directory' '
+    test_must_violate pandora \
+        -m core/sandbox/read:allow \
+        -m "blacklist/read+$HOME_ABSOLUTE/dir1/**" \
+        -m "exec/resume_if_match+/**/env" \
+        -- sh -c "read x < dir6/file6 && env sh -c \"mv dir6 dir7 && ln -s dir1 dir6\" && read x < dir6/file1"
+'
+
+test_expect_success NOT_ROOT 'allow write after a directory is made searchable' '
+    pandora \
+        -m core/sandbox/write:deny \
+        -m "whitelist/write+$HOME_ABSOLUTE/**" \
+        -- sh -c "chmod 0 dir8 && : > dir8/file8 ; chmod 700 dir8 && : > dir8/file8" &&
+    test_path_is_file dir8/file8
+'
+
+test_expect_success 'deny read after the blacklist is changed' '
+    test_must_violate pandora \
+        -m core/sandbox/read:allow \
+        -- sh -c "read x < dir2/file2 && read x < dir2/file2 && test -e /dev/pandora/blacklist/read+$HOME_ABSOLUTE/dir2/** ; read x < dir2/file2"
+'
+
+test_expect_success 'deny write after the whitelist is changed' '
+    test_must_violate pandora \
+        -m core/sandbox/write:deny \
+        -m "whitelist/write+$HOME_ABSOLUTE/dir3/**" \
+        -- sh -c ": > dir3/file5 && test -e /dev/pandora/whitelist/write-$HOME_ABSOLUTE/dir3/** ; : > dir3/file6" &&
+    test_path_is_file dir3/file5 &&
+    test_path_is_missing dir3/file6
+'
+
+test_done
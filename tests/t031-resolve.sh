@@ -0,0 +1,52 @@
+#!/bin/sh
+# vim: set sw=4 et ts=4 sts=4 tw=80 :
+# Copyright 2011 Ali Polatel <alip@exherbo.org>
+# Distributed under the terms of the GNU General Public License v2
+
+test_description='resolve paths with openat2'
+. ./test-lib.sh
+prog="$TEST_DIRECTORY_ABSOLUTE"/resolvebench
+
+test_expect_success setup '
+    mkdir -p dir0/dir1 &&
+    touch dir0/file0 &&
+    ln -s dir0 link0 &&
+    ln -s ../file0 dir0/dir1/link1 &&
+    ln -s non-existant link2 &&
+    ln -s link3 link3
+'
+
+test_expect_success 'openat2 resolves like canonicalize_filename_mode' '
+    $prog -c \
+        "$HOME_ABSOLUTE" \
+        "$HOME_ABSOLUTE"/dir0/ \
+        "$HOME_ABSOLUTE"/dir0/file0 \
+        "$HOME_ABSOLUTE"/dir0/file0/ \
+        "$HOME_ABSOLUTE"/dir0/non-existant \
+        "$HOME_ABSOLUTE"/dir0/non-existant/file \
+        "$HOME_ABSOLUTE"/link0/dir1/../file0 \
+        "$HOME_ABSOLUTE"/link0/dir1/link1 \
+        "$HOME_ABSOLUTE"/link0/non-existant \
+        "$HOME_ABSOLUTE"/link2 \
+        "$HOME_ABSOLUTE"/link3 \
+        "$HOME_ABSOLUTE"//dir0/./dir1/.. \
+        /proc/self
+'
+
+test_expect_success 'allow read with openat2' '
+    pandora \
+        -m core/trace/use_openat2:true \
+        -m core/sandbox/read:deny \
+        -m "whitelist/read+/***" \
+        -- cat link0/dir1/link1
+'
+
+test_expect_success 'deny read with openat2' '
+    test_must_violate pandora \
+        -m core/trace/use_openat2:true \
+        -m core/sandbox/read:allow \
+        -m "blacklist/read+$HOME_ABSOLUTE/dir0/file0" \
+        -- cat link0/dir1/link1
+'
+
+test_done
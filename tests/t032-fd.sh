@@ -0,0 +1,126 @@
+#!/bin/sh
+# vim: set sw=4 et ts=4 sts=4 tw=80 :
+# Copyright 2011 Ali Polatel <alip@exherbo.org>
+# Distributed under the terms of the GNU General Public License v2
+
+test_description='track directory file descriptors'
+. ./test-lib.sh
+prog="$TEST_DIRECTORY_ABSOLUTE"/t032_fd
+
+test_expect_success setup '
+    mkdir dir0 dir1
+'
+
+test_expect_success 'deny openat relative to an opened directory' '
+    test_must_violate pandora \
+        -EPANDORA_TEST_EPERM=1 \
+        -m core/trace/track_fds:true \
+        -m core/sandbox/write:deny \
+        -- $prog open dir0 file0-non-existant &&
+    test_path_is_missing dir0/file0-non-existant
+'
+
+test_expect_success 'allow openat relative to an opened directory' '
+    pandora \
+        -EPANDORA_TEST_SUCCESS=1 \
+        -m core/trace/track_fds:true \
+        -m core/sandbox/write:deny \
+        -m "whitelist/write+$HOME_ABSOLUTE/dir0/*" \
+        -- $prog open dir0 file1-non-existant &&
+    test_path_is_file dir0/file1-non-existant
+'
+
+test_expect_success 'allow openat relative to a duplicated directory' '
+    pandora \
+        -EPANDORA_TEST_SUCCESS=1 \
+        -m core/trace/track_fds:true \
+        -m core/sandbox/write:deny \
+        -m "whitelist/write+$HOME_ABSOLUTE/dir0/*" \
+        -- $prog dup dir0 file2-non-existant &&
+    test_path_is_file dir0/file2-non-existant
+'
+
+test_expect_success 'allow openat relative to a directory checked at open' '
+    pandora \
+        -EPANDORA_TEST_SUCCESS=1 \
+        -m core/trace/track_fds:true \
+        -m core/sandbox/read:allow \
+        -m core/sandbox/write:deny \
+        -m "whitelist/write+$HOME_ABSOLUTE/dir0/*" \
+        -- $prog open dir0 file8-non-existant &&
+    test_path_is_file dir0/file8-non-existant
+'
+
+test_expect_success 'allow openat relative to a directory duplicated onto itself' '
+    pandora \
+        -EPANDORA_TEST_SUCCESS=1 \
+        -m core/trace/track_fds:true \
+        -m core/sandbox/read:allow \
+        -m core/sandbox/write:deny \
+        -m "whitelist/write+$HOME_ABSOLUTE/dir0/*" \
+        -- $prog dup2 dir0 file9-non-existant &&
+    test_path_is_file dir0/file9-non-existant
+'
+
+test_expect_success 'deny openat relative to a reused file descriptor' '
+    test_must_violate pandora \
+        -EPANDORA_TEST_EPERM=1 \
+        -m core/trace/track_fds:true \
+        -m core/sandbox/write:deny \
+        -m "whitelist/write+$HOME_ABSOLUTE/dir0/*" \
+        -- $prog reuse dir0 dir1 file3-non-existant &&
+    test_path_is_missing dir1/file3-non-existant
+'
+
+test_expect_success 'deny openat relative to a file descriptor reused after close_range' '
+    test_must_violate pandora \
+        -EPANDORA_TEST_EPERM=1 \
+        -m core/trace/track_fds:true \
+        -m core/sandbox/write:deny \
+        -m "whitelist/write+$HOME_ABSOLUTE/dir0/*" \
+        -- $prog reuse_range dir0 dir1 file10-non-existant &&
+    test_path_is_missing dir1/file10-non-existant
+'
+
+test_expect_success SECCOMP 'deny openat relative to a reused file descriptor with seccomp' '
+    test_must_violate pandora \
+        -EPANDORA_TEST_EPERM=1 \
+        -m core/trace/use_seccomp:true \
+        -m core/trace/track_fds:true \
+        -m core/sandbox/write:deny \
+        -m "whitelist/write+$HOME_ABSOLUTE/dir0/*" \
+        -- $prog reuse dir0 dir1 file4-non-existant &&
+    test_path_is_missing dir1/file4-non-existant
+'
+
+test_expect_success 'deny open after fchdir' '
+    test_must_violate pandora \
+        -EPANDORA_TEST_EPERM=1 \
+        -m core/trace/track_fds:true \
+        -m core/sandbox/write:deny \
+        -m "whitelist/write+$HOME_ABSOLUTE/dir1/*" \
+        -- $prog fchdir dir0 file6-non-existant &&
+    test_path_is_missing dir0/file6-non-existant
+'
+
+test_expect_success 'allow open after fchdir' '
+    pandora \
+        -EPANDORA_TEST_SUCCESS=1 \
+        -m core/trace/track_fds:true \
+        -m core/sandbox/write:deny \
+        -m "whitelist/write+$HOME_ABSOLUTE/dir0/*" \
+        -- $prog fchdir dir0 file7-non-existant &&
+    test_path_is_file dir0/file7-non-existant
+'
+
+test_expect_success 'allow openat without tracking file descriptors' '
+    pandora \
+        -EPANDORA_TEST_SUCCESS=1 \
+        -m core/trace/track_fds:false \
+        -m core/sandbox/write:deny \
+        -m "whitelist/write+$HOME_ABSOLUTE/dir0/*" \
+        -- $prog open dir0 file5-non-existant &&
+    test_path_is_file dir0/file5-non-existant
+'
+
+test_done
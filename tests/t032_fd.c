@@ -0,0 +1,102 @@
+/* vim: set cino= fo=croql sw=8 ts=8 sts=0 noet cin fdm=syntax : */
+
+#include <sys/types.h>
+#include <sys/syscall.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static int
+close_range_from(int fd)
+{
+#ifdef SYS_close_range
+	return syscall(SYS_close_range, fd, ~0U, 0);
+#else
+	errno = ENOSYS;
+	return -1;
+#endif
+}
+
+/*
+ * Create a file relative to a directory file descriptor:
+ * open dir name: The directory is opened with O_DIRECTORY.
+ * dup dir name: The file descriptor is duplicated and the original closed.
+ * reuse dir dir2 name: The file descriptor is closed after creating a file in
+ * dir and reused for dir2, which is opened without O_DIRECTORY.
+ * reuse_range dir dir2 name: Like reuse, the file descriptor is closed with
+ * close_range() if the kernel has it.
+ * fchdir dir name: The file is created relative to the working directory
+ * after changing into dir with fchdir().
+ */
+int
+main(int argc, char **argv)
+{
+	int fd, nfd;
+	const char *name;
+
+	if (argc < 4)
+		return 125;
+
+	fd = open(argv[2], O_RDONLY | O_DIRECTORY);
+	if (fd < 0) {
+		perror(__FILE__);
+		return 125;
+	}
+
+	if (!strcmp(argv[1], "open"))
+		name = argv[3];
+	else if (!strcmp(argv[1], "dup")) {
+		nfd = dup(fd);
+		close(fd);
+		fd = nfd;
+		name = argv[3];
+	}
+	else if (!strcmp(argv[1], "dup2")) {
+		if (dup2(fd, fd) != fd) {
+			perror(__FILE__);
+			return 125;
+		}
+		name = argv[3];
+	}
+	else if (!strcmp(argv[1], "fchdir")) {
+		if (fchdir(fd) < 0) {
+			perror(__FILE__);
+			return 125;
+		}
+		close(fd);
+		fd = AT_FDCWD;
+		name = argv[3];
+	}
+	else if ((!strcmp(argv[1], "reuse") || !strcmp(argv[1], "reuse_range")) && argc > 4) {
+		nfd = openat(fd, "reuse-file", O_RDONLY | O_CREAT, 0644);
+		if (nfd >= 0)
+			close(nfd);
+		if (strcmp(argv[1], "reuse_range") || close_range_from(fd) < 0)
+			close(fd);
+		if ((nfd = open(argv[3], O_RDONLY)) != fd) {
+			fprintf(stderr, "%s: fd:%d not reused\n", __FILE__, fd);
+			return 125;
+		}
+		name = argv[4];
+	}
+	else
+		return 125;
+
+	fd = openat(fd, name, O_WRONLY | O_CREAT, 0644);
+	if (fd < 0) {
+		if (getenv("PANDORA_TEST_SUCCESS")) {
+			perror(__FILE__);
+			return 1;
+		}
+		else if (getenv("PANDORA_TEST_EPERM") && errno == EPERM)
+			return 0;
+		perror(__FILE__);
+		return 1;
+	}
+
+	close(fd);
+	return getenv("PANDORA_TEST_SUCCESS") ? 0 : 2;
+}
@@ -0,0 +1,56 @@
+#!/bin/sh
+# vim: set sw=4 et ts=4 sts=4 tw=80 :
+# Copyright 2011 Ali Polatel <alip@exherbo.org>
+# Distributed under the terms of the GNU General Public License v2
+
+test_description='track the working directory'
+. ./test-lib.sh
+prog="$TEST_DIRECTORY_ABSOLUTE"/t033_chdir
+
+test_expect_success setup '
+    mkdir dir0 dir1 &&
+    echo file0 > dir0/file0 &&
+    ln -s dir1 link1
+'
+
+test_expect_success 'deny read after chdir' '
+    test_must_violate pandora \
+        -m core/sandbox/read:allow \
+        -m "blacklist/read+$HOME_ABSOLUTE/dir0/**" \
+        -- sh -c "cd dir0 && read x < file0"
+'
+
+test_expect_success 'allow write after chdir into a symbolic link' '
+    pandora \
+        -m core/sandbox/write:deny \
+        -m "whitelist/write+$HOME_ABSOLUTE/dir1/*" \
+        -- sh -c "cd link1 && : > file1" &&
+    test_path_is_file dir1/file1
+'
+
+test_expect_success 'deny write after chdir back' '
+    test_must_violate pandora \
+        -m core/sandbox/write:deny \
+        -m "whitelist/write+$HOME_ABSOLUTE/dir1/*" \
+        -- sh -c "cd link1 && cd .. && : > file2" &&
+    test_path_is_missing file2
+'
+
+test_expect_success SECCOMP 'deny write after chdir back with seccomp' '
+    test_must_violate pandora \
+        -m core/trace/use_seccomp:true \
+        -m core/sandbox/write:deny \
+        -m "whitelist/write+$HOME_ABSOLUTE/dir1/*" \
+        -- sh -c "cd link1 && cd .. && : > file3" &&
+    test_path_is_missing file3
+'
+
+test_expect_success 'deny write after chdir with an argument changed by another thread' '
+    { pandora \
+        -m core/sandbox/write:deny \
+        -m "whitelist/write+$HOME_ABSOLUTE/dir1/*" \
+        -- $prog dir0 dir1 file4 2000 2>/dev/null || true; } &&
+    test_path_is_missing dir0/file4
+'
+
+test_done
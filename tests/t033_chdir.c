@@ -0,0 +1,73 @@
+/* vim: set cino= fo=croql sw=8 ts=8 sts=0 noet cin fdm=syntax : */
+
+#include <sys/types.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static char dir[PATH_MAX];
+static const char *dirs[2];
+static volatile int started, done;
+
+/* Flip the argument of chdir() between the two directories */
+static void *
+flip(void *arg)
+{
+	unsigned i = 0;
+
+	(void)arg;
+	started = 1;
+	while (!done)
+		strcpy(dir, dirs[++i % 2]);
+	return NULL;
+}
+
+/*
+ * Change into a directory while another thread rewrites the path argument:
+ * dir0 dir1 name iterations: chdir() into dir0 or dir1, whichever the kernel
+ * sees, and create name there, then change back to the parent directory.
+ * The directories must have the same length.
+ */
+int
+main(int argc, char **argv)
+{
+	int fd;
+	unsigned iterations;
+	pthread_t thread;
+
+	if (argc < 5 || strlen(argv[1]) != strlen(argv[2]) || strlen(argv[1]) >= PATH_MAX)
+		return 125;
+
+	dirs[0] = argv[1];
+	dirs[1] = argv[2];
+	iterations = atoi(argv[4]);
+	strcpy(dir, dirs[0]);
+
+	if ((errno = pthread_create(&thread, NULL, flip, NULL))) {
+		perror(__FILE__);
+		return 125;
+	}
+	while (!started)
+		;
+
+	for (unsigned i = 0; i < iterations; i++) {
+		if (chdir(dir) < 0)
+			continue;
+		fd = open(argv[3], O_WRONLY | O_CREAT, 0644);
+		if (fd >= 0)
+			close(fd);
+		if (chdir("..") < 0) {
+			perror(__FILE__);
+			return 125;
+		}
+	}
+
+	done = 1;
+	pthread_join(thread, NULL);
+	return 0;
+}
@@ -0,0 +1,40 @@
+#!/bin/sh
+# vim: set sw=4 et ts=4 sts=4 tw=80 :
+# Copyright 2011 Ali Polatel <alip@exherbo.org>
+# Distributed under the terms of the GNU General Public License v2
+
+test_description='share patterns and paths between processes'
+. ./test-lib.sh
+
+test_expect_success setup '
+    mkdir dir0
+'
+
+test_expect_success 'allow write with a pattern added twice and removed once' '
+    pandora \
+        -m core/sandbox/write:deny \
+        -m "whitelist/write+$HOME_ABSOLUTE/dir0/*" \
+        -m "whitelist/write+$HOME_ABSOLUTE/dir0/*" \
+        -m "whitelist/write-$HOME_ABSOLUTE/dir0/*" \
+        -- sh -c ": > dir0/file0" &&
+    test_path_is_file dir0/file0
+'
+
+test_expect_success 'deny write with a pattern added and removed' '
+    test_must_violate pandora \
+        -m core/sandbox/write:deny \
+        -m "whitelist/write+$HOME_ABSOLUTE/dir0/*" \
+        -m "whitelist/write-$HOME_ABSOLUTE/dir0/*" \
+        -- sh -c ": > dir0/file1" &&
+    test_path_is_missing dir0/file1
+'
+
+test_expect_success 'allow write in a grandchild after its parents exit' '
+    pandora \
+        -m core/sandbox/write:deny \
+        -m "whitelist/write+$HOME_ABSOLUTE/dir0/*" \
+        -- sh -c "cd dir0 && (sh -c \"sleep 1 && : > file2\" &) ; exit 0" &&
+    test_path_is_file dir0/file2
+'
+
+test_done
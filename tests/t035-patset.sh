@@ -0,0 +1,66 @@
+#!/bin/sh
+# vim: set sw=4 et ts=4 sts=4 tw=80 :
+# Copyright 2011 Ali Polatel <alip@exherbo.org>
+# Distributed under the terms of the GNU General Public License v2
+
+test_description='match paths against compiled pattern lists'
+. ./test-lib.sh
+
+test_expect_success setup '
+    mkdir -p dir0/sub dir1 dir2
+'
+
+test_expect_success 'allow write under a directory pattern' '
+    pandora \
+        -m core/sandbox/write:deny \
+        -m "whitelist/write+$HOME_ABSOLUTE/dir0/***" \
+        -- sh -c ": > dir0/file0 && : > dir0/sub/file1" &&
+    test_path_is_file dir0/file0 &&
+    test_path_is_file dir0/sub/file1
+'
+
+test_expect_success 'deny write next to a directory pattern' '
+    test_must_violate pandora \
+        -m core/sandbox/write:deny \
+        -m "whitelist/write+$HOME_ABSOLUTE/dir0/***" \
+        -- sh -c ": > dir0x" &&
+    test_path_is_missing dir0x
+'
+
+test_expect_success 'allow write to a literal path only' '
+    test_must_violate pandora \
+        -m core/sandbox/write:deny \
+        -m "whitelist/write+$HOME_ABSOLUTE/dir1/file0" \
+        -- sh -c ": > dir1/file0 && : > dir1/file00" &&
+    test_path_is_file dir1/file0 &&
+    test_path_is_missing dir1/file00
+'
+
+test_expect_success 'allow write with character classes and wildcards' '
+    pandora \
+        -m core/sandbox/write:deny \
+        -m "whitelist/write+/nonexistent/**" \
+        -m "whitelist/write+$HOME_ABSOLUTE/dir[0-1]/f?le[!0-2]" \
+        -- sh -c ": > dir1/file3" &&
+    test_path_is_file dir1/file3
+'
+
+test_expect_success 'deny write not matching character classes' '
+    test_must_violate pandora \
+        -m core/sandbox/write:deny \
+        -m "whitelist/write+/nonexistent/**" \
+        -m "whitelist/write+$HOME_ABSOLUTE/dir[0-1]/f?le[!0-2]" \
+        -- sh -c ": > dir2/file3" &&
+    test_path_is_missing dir2/file3
+'
+
+test_expect_success 'deny write after a pattern is removed in a child' '
+    test_must_violate pandora \
+        -m core/sandbox/write:deny \
+        -m "whitelist/write+$HOME_ABSOLUTE/dir2/*" \
+        -- sh -c ": > dir2/file4 && test -e /dev/pandora/whitelist/write-$HOME_ABSOLUTE/dir2/* ; : > dir2/file5" &&
+    test_path_is_file dir2/file4 &&
+    test_path_is_missing dir2/file5
+'
+
+test_done
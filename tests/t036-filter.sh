@@ -0,0 +1,56 @@
+#!/bin/sh
+# vim: set sw=4 et ts=4 sts=4 tw=80 :
+# Copyright 2011 Ali Polatel <alip@exherbo.org>
+# Distributed under the terms of the GNU General Public License v2
+
+test_description='filter paths by the literal prefixes of pattern lists'
+. ./test-lib.sh
+
+test_expect_success setup '
+    mkdir dir0 dir1 dir2
+'
+
+test_expect_success 'allow write next to a blacklisted directory' '
+    pandora \
+        -m core/sandbox/write:allow \
+        -m "blacklist/write+$HOME_ABSOLUTE/dir0/sub/***" \
+        -- sh -c ": > dir0/file0 && : > dir0/sub0" &&
+    test_path_is_file dir0/file0 &&
+    test_path_is_file dir0/sub0
+'
+
+test_expect_success 'deny creating a blacklisted directory' '
+    test_must_violate pandora \
+        -m core/sandbox/write:allow \
+        -m "blacklist/write+$HOME_ABSOLUTE/dir0/sub/***" \
+        -- mkdir dir0/sub &&
+    test_path_is_missing dir0/sub
+'
+
+test_expect_success 'deny write with a pattern without a literal prefix' '
+    test_must_violate pandora \
+        -m core/sandbox/write:allow \
+        -m "blacklist/write+/nonexistent/**" \
+        -m "blacklist/write+**/secret*" \
+        -- sh -c ": > dir1/secret0" &&
+    test_path_is_missing dir1/secret0
+'
+
+test_expect_success 'deny write after a duplicate pattern is removed' '
+    test_must_violate pandora \
+        -m core/sandbox/write:allow \
+        -m "blacklist/write+$HOME_ABSOLUTE/dir2/*" \
+        -m "blacklist/write+$HOME_ABSOLUTE/dir2/*" \
+        -- sh -c "test -e /dev/pandora/blacklist/write-$HOME_ABSOLUTE/dir2/* ; : > dir2/file0" &&
+    test_path_is_missing dir2/file0
+'
+
+test_expect_success 'allow write after a pattern is removed' '
+    pandora \
+        -m core/sandbox/write:allow \
+        -m "blacklist/write+$HOME_ABSOLUTE/dir2/*" \
+        -- sh -c "test -e /dev/pandora/blacklist/write-$HOME_ABSOLUTE/dir2/* ; : > dir2/file1" &&
+    test_path_is_file dir2/file1
+'
+
+test_done
@@ -0,0 +1,38 @@
+#!/bin/sh
+# vim: set sw=4 et ts=4 sts=4 tw=80 :
+# Copyright 2011 Ali Polatel <alip@exherbo.org>
+# Distributed under the terms of the GNU General Public License v2
+
+test_description='whitelist successful bind() calls'
+. ./test-lib.sh
+prog="$TEST_DIRECTORY_ABSOLUTE"/t037_bind
+
+test_expect_success 'deny connect() without whitelisting successful bind()' '
+    test_must_violate pandora \
+        -EPANDORA_TEST_EPERM=1 \
+        -m core/sandbox/sock:deny \
+        -m core/whitelist/successful_bind:false \
+        -m "whitelist/sock/bind+unix:$HOME_ABSOLUTE/sock0" \
+        -- $prog "$HOME_ABSOLUTE"/sock0
+'
+
+test_expect_success 'allow connect() to the address of a successful bind()' '
+    pandora \
+        -EPANDORA_TEST_SUCCESS=1 \
+        -m core/sandbox/sock:deny \
+        -m core/whitelist/successful_bind:true \
+        -m "whitelist/sock/bind+unix:$HOME_ABSOLUTE/sock1" \
+        -- $prog "$HOME_ABSOLUTE"/sock1
+'
+
+test_expect_success SECCOMP 'allow connect() to the address of a successful bind() with seccomp' '
+    pandora \
+        -EPANDORA_TEST_SUCCESS=1 \
+        -m core/trace/use_seccomp:true \
+        -m core/sandbox/sock:deny \
+        -m core/whitelist/successful_bind:true \
+        -m "whitelist/sock/bind+unix:$HOME_ABSOLUTE/sock2" \
+        -- $prog "$HOME_ABSOLUTE"/sock2
+'
+
+test_done
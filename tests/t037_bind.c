@@ -0,0 +1,47 @@
+/* vim: set cino= fo=croql sw=8 ts=8 sts=0 noet cin fdm=syntax : */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+/*
+ * Bind a UNIX socket to the given path and connect to it with another socket.
+ * The connection is only allowed if the bind() call was seen to succeed.
+ */
+int
+main(int argc, char **argv)
+{
+	int fd, cfd;
+	struct sockaddr_un addr;
+
+	if (argc < 2 || strlen(argv[1]) >= sizeof(addr.sun_path))
+		return 125;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, argv[1]);
+
+	if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0
+			|| (cfd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) {
+		perror(__FILE__);
+		return 125;
+	}
+
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, 1) < 0) {
+		perror(__FILE__);
+		return 125;
+	}
+
+	if (connect(cfd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+		if (getenv("PANDORA_TEST_EPERM") && errno == EPERM)
+			return 0;
+		perror(__FILE__);
+		return 1;
+	}
+
+	return getenv("PANDORA_TEST_SUCCESS") ? 0 : 2;
+}
@@ -20,6 +20,7 @@
 /*
  * Modified by Ali Polatel <alip@exherbo.org>
  * - Use getopt_long() instead of popt
+ * - Add --bench to measure the throughput of the matching kernels
  */
 
 /*#define COMPARE_WITH_FNMATCH*/
@@ -34,6 +35,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #ifndef MAXPATHLEN
 #ifdef PATH_MAX
@@ -60,6 +62,28 @@ int explode_mod = 0;
 int empties_mod = 0;
 int empty_at_start = 0;
 int empty_at_end = 0;
+int bench_rounds = 0;
+
+#define BENCH_MAX 1024
+int bench_count = 0;
+char *bench_text[BENCH_MAX], *bench_pattern[BENCH_MAX];
+
+/* Long paths, like those pandora matches, to go with the test file. */
+static const char *bench_long[] = {
+    "/var/tmp/paludis/build/dev-libs-pkg-100/work/pkg-100/src/some/deep/dir/file.o",
+    "/var/tmp/paludis/build/dev-libs-pkg-100/work/pkg-100/src/some/deep/dir/file.o",
+    "/var/tmp/paludis/build/dev-libs-pkg-100/work/pkg-100/src/some/deep/dir/file.o",
+    "/var/tmp/paludis/build/**/*.o",
+    "/var/tmp/paludis/build/dev-libs-pkg-100/work/pkg-100/src/some/deep/dir/file.o",
+    "/var/tmp/paludis/build/dev-libs-pkg-100/work/pkg-100/src/some/deep/dir/file.c",
+    "/home/user/src/project/a/very/long/path/which/matches/nothing/at/all.c",
+    "/home/user/src/project/**/at/all.h",
+    "/home/user/src/project/a/very/long/path/which/matches/nothing/at/all.c",
+    "/home/user/src/*/a/very/long/path/which/*/nothing/at/all.c",
+    "/usr/lib/python3.9/site-packages/foo/bar/baz/__init__.pyc",
+    "**/__init__.py",
+    NULL,
+};
 
 #if 0
 static struct poptOption long_options[] = {
@@ -75,6 +99,7 @@ static struct option long_options[] = {
 	{"iterations",	no_argument,		0, 'i'},
 	{"empties",	required_argument,	0, 'e'},
 	{"explode",	required_argument,	0, 'x'},
+	{"bench",	required_argument,	0, 'b'},
 	{NULL,		0,			0,  0},
 };
 
@@ -134,6 +159,52 @@ run_test(int line, bool matches, bool same_as_fnmatch,
     }
 }
 
+static unsigned long long
+now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void
+bench_add(const char *text, const char *pattern)
+{
+    if (bench_count == BENCH_MAX)
+	return;
+    bench_text[bench_count] = strdup(text);
+    bench_pattern[bench_count] = strdup(pattern);
+    bench_count++;
+}
+
+/* Match every pair "bench_rounds" times with the given kernels. */
+static void
+bench_run(int simd)
+{
+    int i, r, matched = 0;
+    unsigned long long start, ns, bytes = 0;
+
+    wildmatch_select_kernel(simd);
+    for (i = 0; i < bench_count; i++)
+	bytes += strlen(bench_text[i]);
+
+    start = now();
+    for (r = 0; r < bench_rounds; r++) {
+	for (i = 0; i < bench_count; i++)
+	    matched += wildmatch(bench_pattern[i], bench_text[i]);
+    }
+    ns = now() - start;
+    if (!ns)
+	ns = 1;
+
+    printf("%-8s %d matches in %llu ns: %llu ns/match, %llu MB/s\n",
+	   wildmatch_kernel, bench_count * bench_rounds, ns,
+	   ns / ((unsigned long long)bench_count * bench_rounds),
+	   bytes * bench_rounds * 1000 / ns);
+    (void)matched;
+}
+
 int
 main(int argc, char **argv)
 {
@@ -142,7 +213,7 @@ main(int argc, char **argv)
     int opt, line, i, flag[2];
     int option_index = 0;
 
-    while ((opt = getopt_long(argc, argv, "ie:x:", long_options, &option_index)) != EOF) {
+    while ((opt = getopt_long(argc, argv, "ie:x:b:", long_options, &option_index)) != EOF) {
 	switch(opt) {
 	case 'i':
 		output_iterations = 1;
@@ -159,6 +230,13 @@ main(int argc, char **argv)
 		if (!explode_mod)
 			explode_mod = 1024;
 		break;
+	case 'b':
+		bench_rounds = atoi(optarg);
+		if (bench_rounds <= 0) {
+			fprintf(stderr, "Invalid number of rounds: %s\n", optarg);
+			exit(1);
+		}
+		break;
 	default:
 		exit(1);
 	}
@@ -227,6 +305,8 @@ main(int argc, char **argv)
 	}
 	*end[0] = *end[1] = '\0';
 	run_test(line, flag[0], flag[1], string[0], string[1]);
+	if (bench_rounds)
+	    bench_add(string[0], string[1]);
     }
 
     if (!wildmatch_errors)
@@ -244,5 +324,12 @@ main(int argc, char **argv)
 
 #endif
 
+    if (bench_rounds) {
+	for (i = 0; bench_long[i]; i += 2)
+	    bench_add(bench_long[i], bench_long[i + 1]);
+	bench_run(0);
+	bench_run(1);
+    }
+
     return 0;
 }